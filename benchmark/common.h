@@ -0,0 +1,65 @@
+#ifndef BENCHMARK_COMMON_H_
+#define BENCHMARK_COMMON_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+// Items moved per benchmark iteration, divisible by every producer and consumer count swept
+inline constexpr std::size_t kItems = 1 << 16;
+
+// Posted value of Size bytes, stamped when it's created so that latency can be read when it's processed
+template <std::size_t Size>
+struct Payload {
+    static_assert(Size >= sizeof(std::chrono::steady_clock::time_point));
+
+    Payload() noexcept
+        : posted { std::chrono::steady_clock::now() }
+    {
+    }
+
+    std::uint64_t Elapsed() const noexcept
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - posted).count());
+    }
+
+    std::chrono::steady_clock::time_point posted;
+    std::array<std::byte, Size - sizeof(std::chrono::steady_clock::time_point)> bytes {};
+};
+
+// Lets the benchmark thread wait until workers went through a known number of items
+class Countdown {
+public:
+    void Reset(std::size_t count) noexcept
+    {
+        remaining_.store(count, std::memory_order_relaxed);
+    }
+
+    void Arrive() noexcept
+    {
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            remaining_.notify_all();
+    }
+
+    void Wait() const noexcept
+    {
+        for (auto remaining = remaining_.load(std::memory_order_acquire); remaining != 0; remaining = remaining_.load(std::memory_order_acquire))
+            remaining_.wait(remaining, std::memory_order_acquire);
+    }
+
+private:
+    std::atomic_size_t remaining_ { 0 };
+};
+
+// Busy work standing for the cost of processing an item
+inline void Work(std::size_t rounds) noexcept
+{
+    for (std::size_t round = 0; round < rounds; ++round)
+        benchmark::ClobberMemory();
+}
+
+#endif // BENCHMARK_COMMON_H_
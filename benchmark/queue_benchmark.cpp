@@ -0,0 +1,96 @@
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "block_allocator.h"
+#include "common.h"
+#include "concurrent_queue.h"
+#include "priority_queue.h"
+#include "ring_queue.h"
+#include "spsc_queue.h"
+
+namespace {
+
+template <typename Queue>
+void Produce(Queue& queue, std::size_t count)
+{
+    for (std::size_t n = 0; n < count; ++n)
+        queue.Emplace();
+}
+
+// Into pops into the same storage every time instead of a std::optional
+template <typename Queue, bool Into>
+void Consume(Queue& queue, std::size_t count)
+{
+    typename Queue::value_type value;
+
+    for (std::size_t n = 0; n < count; ++n) {
+        if constexpr (Into)
+            benchmark::DoNotOptimize(queue.Pop(value));
+        else
+            benchmark::DoNotOptimize(queue.Pop());
+    }
+}
+
+// Moves kItems from range(0) producers to range(1) consumers, each blocking on the queue when it has to
+template <typename Queue, bool Into = false>
+void BM_Queue(benchmark::State& state)
+{
+    const auto producers = static_cast<std::size_t>(state.range(0));
+    const auto consumers = static_cast<std::size_t>(state.range(1));
+
+    for (auto _ : state) {
+        Queue queue;
+        std::vector<std::thread> threads;
+
+        threads.reserve(producers + consumers);
+        for (std::size_t n = 0; n < consumers; ++n)
+            threads.emplace_back(Consume<Queue, Into>, std::ref(queue), kItems / consumers);
+        for (std::size_t n = 0; n < producers; ++n)
+            threads.emplace_back(Produce<Queue>, std::ref(queue), kItems / producers);
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * kItems * sizeof(typename Queue::value_type)));
+}
+
+// SPSC, then MPSC, then MPMC
+void Shapes(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "producers", "consumers" });
+    benchmark->Args({ 1, 1 });
+
+    for (std::int64_t producers : { 2, 4, 8 })
+        benchmark->Args({ producers, 1 });
+
+    for (std::int64_t threads : { 2, 4, 8 })
+        benchmark->Args({ threads, threads });
+
+    benchmark->UseRealTime();
+}
+
+} // namespace
+
+BENCHMARK(BM_Queue<ConcurrentQueue<Payload<8>>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<ConcurrentQueue<Payload<64>>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<ConcurrentQueue<Payload<256>>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<ConcurrentQueue<Payload<256>>, true>)->Apply(Shapes);
+BENCHMARK(BM_Queue<ConcurrentQueue<Payload<8>, BlockAllocator<Payload<8>>>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<ConcurrentQueue<Payload<256>, BlockAllocator<Payload<256>>>>)->Apply(Shapes);
+
+BENCHMARK(BM_Queue<RingQueue<Payload<8>, 1024>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<RingQueue<Payload<64>, 1024>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<RingQueue<Payload<256>, 1024>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<RingQueue<Payload<256>, 1024>, true>)->Apply(Shapes);
+
+// One producer and one consumer only
+BENCHMARK(BM_Queue<SpscQueue<Payload<8>, 1024>>)->ArgNames({ "producers", "consumers" })->Args({ 1, 1 })->UseRealTime();
+BENCHMARK(BM_Queue<SpscQueue<Payload<256>, 1024>>)->ArgNames({ "producers", "consumers" })->Args({ 1, 1 })->UseRealTime();
+
+BENCHMARK(BM_Queue<PriorityQueue<Payload<8>, 3>>)->Apply(Shapes);
+BENCHMARK(BM_Queue<PriorityQueue<Payload<64>, 3>>)->Apply(Shapes);
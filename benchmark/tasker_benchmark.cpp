@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "common.h"
+#include "pipeline.h"
+#include "tasker.h"
+
+namespace {
+
+// Posts kItems from range(0) threads, the calling one included, and waits for the workers to go through them
+template <std::size_t N, typename Value, typename Queue = ConcurrentQueue<Value>, Placement P = Placement::RoundRobin, typename Policy = Dynamic>
+void BM_Post(benchmark::State& state)
+{
+    const auto producers = static_cast<std::size_t>(state.range(0));
+    Countdown countdown;
+    Tasker<Value, N, Queue, Policy> tasker {
+        [&](Value value) {
+            benchmark::DoNotOptimize(value);
+            countdown.Arrive();
+        },
+        { .placement = P }
+    };
+
+    auto produce = [&] {
+        for (std::size_t n = 0; n < kItems / producers; ++n)
+            tasker.Post(Value {});
+    };
+
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+
+        countdown.Reset(kItems);
+
+        for (std::size_t n = 1; n < producers; ++n)
+            threads.emplace_back(produce);
+
+        produce();
+
+        for (auto& thread : threads)
+            thread.join();
+
+        countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+template <std::size_t N, typename Value>
+void BM_PostRange(benchmark::State& state)
+{
+    Countdown countdown;
+    Tasker<Value, N> tasker { [&](Value value) {
+        benchmark::DoNotOptimize(value);
+        countdown.Arrive();
+    } };
+    std::vector<Value> values(kItems);
+
+    for (auto _ : state) {
+        countdown.Reset(kItems);
+        tasker.PostRange(values);
+        countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+template <std::size_t N, typename Value>
+struct Counter : TaskerBase<Counter<N, Value>, Value, N> {
+    ~Counter()
+    {
+        this->Stop();
+    }
+
+    void Process(Value value)
+    {
+        benchmark::DoNotOptimize(value);
+        countdown.Arrive();
+    }
+
+    Countdown countdown;
+};
+
+template <std::size_t N, typename Value>
+void BM_TaskerBase(benchmark::State& state)
+{
+    Counter<N, Value> counter;
+
+    for (auto _ : state) {
+        counter.countdown.Reset(kItems);
+
+        for (std::size_t n = 0; n < kItems; ++n)
+            counter.Post(Value {});
+
+        counter.countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+// Post-to-execute latency in bursts of range(0) items, the burst being waited for before the next one
+//
+// A burst of 1 is an unloaded round trip, bigger ones show queueing behind the items posted before.
+template <std::size_t N, typename Value>
+void BM_Latency(benchmark::State& state)
+{
+    const auto burst = static_cast<std::size_t>(state.range(0));
+    std::vector<std::uint64_t> latencies(burst);
+    Countdown countdown;
+    Histogram histogram;
+    Tasker<std::pair<Value, std::size_t>, N> tasker { [&](std::pair<Value, std::size_t> item) {
+        // Every slot has a single writer, and Wait() synchronizes with it
+        latencies[item.second] = item.first.Elapsed();
+        countdown.Arrive();
+    } };
+
+    for (auto _ : state) {
+        countdown.Reset(burst);
+
+        for (std::size_t n = 0; n < burst; ++n)
+            tasker.Post(Value {}, n);
+
+        countdown.Wait();
+
+        for (auto latency : latencies)
+            ++histogram.buckets[Histogram::Index(latency)];
+    }
+
+    state.counters["p50_ns"] = static_cast<double>(histogram.Quantile(0.5));
+    state.counters["p99_ns"] = static_cast<double>(histogram.Quantile(0.99));
+    state.counters["p999_ns"] = static_cast<double>(histogram.Quantile(0.999));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * burst));
+}
+
+// Every item of depth d posts two of depth d - 1 from its worker, so the tree spreads only through stealing
+template <std::size_t N>
+void BM_FanOut(benchmark::State& state)
+{
+    const auto depth = static_cast<int>(state.range(0));
+    const auto count = (std::size_t { 1 } << (depth + 1)) - 1;
+    Countdown countdown;
+    Tasker<int, N>* self = nullptr;
+    Tasker<int, N> tasker { [&](int value) {
+        if (value > 0) {
+            self->Post(value - 1);
+            self->Post(value - 1);
+        }
+
+        Work(64);
+        countdown.Arrive();
+    } };
+
+    self = &tasker;
+
+    for (auto _ : state) {
+        countdown.Reset(count);
+        tasker.Post(depth);
+        countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+}
+
+// One item in 16 costs range(0) times as much as the others, which leaves some workers behind after PostRange
+template <std::size_t N>
+void BM_Skewed(benchmark::State& state)
+{
+    const auto skew = static_cast<std::size_t>(state.range(0));
+    Countdown countdown;
+    Tasker<std::size_t, N> tasker { [&](std::size_t rounds) {
+        Work(rounds);
+        countdown.Arrive();
+    } };
+    std::vector<std::size_t> rounds(kItems / 16);
+
+    for (std::size_t n = 0; n < rounds.size(); ++n)
+        rounds[n] = n % 16 == 0 ? 16 * skew : 16;
+
+    for (auto _ : state) {
+        countdown.Reset(rounds.size());
+        tasker.PostRange(rounds);
+        countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * rounds.size()));
+}
+
+// One item in 8 sleeps for range(0) microseconds, inside a BlockingScope if Scoped, with up to 2N workers
+template <std::size_t N, bool Scoped>
+void BM_Blocking(benchmark::State& state)
+{
+    const auto sleep = std::chrono::microseconds { state.range(0) };
+    constexpr std::size_t kCount = 1024;
+    Countdown countdown;
+    Tasker<std::size_t, N> tasker {
+        [&](std::size_t n) {
+            if (n % 8 == 0) {
+                if constexpr (Scoped) {
+                    BlockingScope blocking;
+
+                    std::this_thread::sleep_for(sleep);
+                } else {
+                    std::this_thread::sleep_for(sleep);
+                }
+            }
+
+            Work(16);
+            countdown.Arrive();
+        },
+        { .elastic = { .max = 2 * N } }
+    };
+
+    for (auto _ : state) {
+        countdown.Reset(kCount);
+
+        for (std::size_t n = 0; n < kCount; ++n)
+            tasker.Post(n);
+
+        countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kCount));
+}
+
+// range(0) Taskers of N workers each, or PooledTaskers sharing a pool of N, all posted to in turn
+template <std::size_t N, bool Pooled>
+void BM_Pooled(benchmark::State& state)
+{
+    using Front = std::conditional_t<Pooled, PooledTasker<std::size_t>, Tasker<std::size_t, N>>;
+
+    const auto count = static_cast<std::size_t>(state.range(0));
+    Countdown countdown;
+    WorkerPool pool { N };
+    std::vector<std::unique_ptr<Front>> taskers;
+
+    auto process = [&](std::size_t rounds) {
+        Work(rounds);
+        countdown.Arrive();
+    };
+
+    for (std::size_t n = 0; n < count; ++n) {
+        if constexpr (Pooled)
+            taskers.push_back(std::make_unique<Front>(pool, process));
+        else
+            taskers.push_back(std::make_unique<Front>(process));
+    }
+
+    for (auto _ : state) {
+        countdown.Reset(kItems);
+
+        for (std::size_t n = 0; n < kItems; ++n)
+            taskers[n % count]->Post(std::size_t { 16 });
+
+        countdown.Wait();
+    }
+
+    taskers.clear();
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+// A request-scoped Tasker of N workers, built, posted range(0) items, drained and destroyed on every iteration
+template <std::size_t N, bool Lazy>
+void BM_Construct(benchmark::State& state)
+{
+    const auto count = static_cast<std::size_t>(state.range(0));
+
+    for (auto _ : state) {
+        Tasker<std::size_t, N> tasker { [](std::size_t rounds) { Work(rounds); }, { .lazy = Lazy } };
+
+        for (std::size_t n = 0; n < count; ++n)
+            tasker.Post(std::size_t { 16 });
+    }
+}
+
+// Closures capturing Capture bytes, run by an Executor over Function, Task or std::function<void()>
+template <std::size_t N, typename Function, std::size_t Capture>
+void BM_Executor(benchmark::State& state)
+{
+    Countdown countdown;
+    Executor<N, Function> executor;
+    std::array<char, Capture - sizeof(Countdown*)> payload {};
+
+    for (auto _ : state) {
+        countdown.Reset(kItems);
+
+        for (std::size_t n = 0; n < kItems; ++n) {
+            executor.Post([&countdown, payload] {
+                benchmark::DoNotOptimize(payload);
+                countdown.Arrive();
+            });
+        }
+
+        countdown.Wait();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+// Sums kItems values per iteration, with ParallelReduce() when Parallel is set and one Post per value otherwise
+template <std::size_t N, bool Parallel>
+void BM_Reduce(benchmark::State& state)
+{
+    Executor<N> executor;
+    std::vector<std::int64_t> values(kItems, 1);
+
+    for (auto _ : state) {
+        if constexpr (Parallel) {
+            benchmark::DoNotOptimize(executor.ParallelReduce(values, std::int64_t { 0 }, std::plus<> {}));
+        } else {
+            std::atomic<std::int64_t> sum { 0 };
+            Countdown countdown;
+
+            countdown.Reset(kItems);
+
+            for (const auto value : values) {
+                executor.Post([&sum, &countdown, value] {
+                    sum.fetch_add(value, std::memory_order_relaxed);
+                    countdown.Arrive();
+                });
+            }
+
+            countdown.Wait();
+            benchmark::DoNotOptimize(sum.load());
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+// Three stages of 256-byte payloads: Taskers posting to each other, a Pipeline handing off between them, and one fused
+template <int Mode>
+void BM_Pipeline(benchmark::State& state)
+{
+    using Value = Payload<256>;
+
+    Countdown countdown;
+    auto last = [&](Value value) {
+        benchmark::DoNotOptimize(value);
+        countdown.Arrive();
+    };
+
+    auto run = [&](auto& first) {
+        for (auto _ : state) {
+            countdown.Reset(kItems);
+
+            for (std::size_t i = 0; i < kItems; ++i)
+                first.Post();
+
+            countdown.Wait();
+        }
+    };
+
+    if constexpr (Mode == 0) {
+        Tasker<Value, 1> third { last };
+        Tasker<Value, 1> second { [&](Value value) { third.Post(std::move(value)); } };
+        Tasker<Value, 1> first { [&](Value value) { second.Post(std::move(value)); } };
+
+        run(first);
+    } else if constexpr (Mode == 1) {
+        Pipeline pipeline { Stage([](Value value) { return value; }), Stage([](Value value) { return value; }), Stage(last) };
+
+        run(pipeline);
+    } else {
+        Pipeline pipeline { Stage([](Value value) { return value; }), Fuse([](Value value) { return value; }), Fuse(last) };
+
+        run(pipeline);
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kItems));
+}
+
+void Producers(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgName("producers")->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+}
+
+} // namespace
+
+// Worker counts N = 1 (its own specialization), 2, 4 and 8 with payloads of 8, 64 and 256 bytes
+BENCHMARK(BM_Post<1, Payload<8>>)->Apply(Producers);
+BENCHMARK(BM_Post<2, Payload<8>>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<8>>)->Apply(Producers);
+BENCHMARK(BM_Post<8, Payload<8>>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<64>>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<256>>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<8>, ConcurrentQueue<Payload<8>>, Placement::Affinity>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<8>, ConcurrentQueue<Payload<8>>, Placement::TwoChoices>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<8>, ConcurrentQueue<Payload<8>>, Placement::RoundRobin, Static<>>)->Apply(Producers);
+BENCHMARK(BM_Post<1, Payload<8>, RingQueue<Payload<8>, 1024>>)->Apply(Producers);
+BENCHMARK(BM_Post<4, Payload<8>, RingQueue<Payload<8>, 1024>>)->Apply(Producers);
+BENCHMARK(BM_Post<1, Payload<8>, EventQueue<Payload<8>>>)->Apply(Producers);
+BENCHMARK(BM_Post<1, Payload<8>, SpscQueue<Payload<8>, 1024>>)->ArgName("producers")->Arg(1)->UseRealTime();
+
+BENCHMARK(BM_PostRange<1, Payload<8>>)->UseRealTime();
+BENCHMARK(BM_PostRange<4, Payload<8>>)->UseRealTime();
+BENCHMARK(BM_PostRange<4, Payload<256>>)->UseRealTime();
+
+BENCHMARK(BM_TaskerBase<1, Payload<8>>)->UseRealTime();
+BENCHMARK(BM_TaskerBase<4, Payload<8>>)->UseRealTime();
+BENCHMARK(BM_TaskerBase<4, Payload<64>>)->UseRealTime();
+
+BENCHMARK(BM_Latency<1, Payload<8>>)->ArgName("burst")->RangeMultiplier(8)->Range(1, 512)->UseRealTime();
+BENCHMARK(BM_Latency<4, Payload<8>>)->ArgName("burst")->RangeMultiplier(8)->Range(1, 512)->UseRealTime();
+BENCHMARK(BM_Latency<4, Payload<256>>)->ArgName("burst")->RangeMultiplier(8)->Range(1, 512)->UseRealTime();
+
+BENCHMARK(BM_FanOut<2>)->ArgName("depth")->Arg(12)->UseRealTime();
+BENCHMARK(BM_FanOut<4>)->ArgName("depth")->Arg(12)->UseRealTime();
+BENCHMARK(BM_FanOut<8>)->ArgName("depth")->Arg(12)->UseRealTime();
+
+BENCHMARK(BM_Skewed<2>)->ArgName("skew")->Arg(1)->Arg(64)->UseRealTime();
+BENCHMARK(BM_Skewed<4>)->ArgName("skew")->Arg(1)->Arg(64)->UseRealTime();
+BENCHMARK(BM_Skewed<8>)->ArgName("skew")->Arg(1)->Arg(64)->UseRealTime();
+
+BENCHMARK(BM_Blocking<4, false>)->ArgName("sleep_us")->Arg(100)->UseRealTime();
+BENCHMARK(BM_Blocking<4, true>)->ArgName("sleep_us")->Arg(100)->UseRealTime();
+
+BENCHMARK(BM_Construct<1, false>)->ArgName("items")->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_Construct<1, true>)->ArgName("items")->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_Construct<4, false>)->ArgName("items")->Arg(0)->Arg(1)->UseRealTime();
+BENCHMARK(BM_Construct<4, true>)->ArgName("items")->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK(BM_Executor<1, Task, 48>)->UseRealTime();
+BENCHMARK(BM_Executor<1, std::function<void()>, 48>)->UseRealTime();
+BENCHMARK(BM_Executor<4, Task, 48>)->UseRealTime();
+BENCHMARK(BM_Executor<4, std::function<void()>, 48>)->UseRealTime();
+BENCHMARK(BM_Executor<4, InplaceTask<128>, 112>)->UseRealTime();
+
+BENCHMARK(BM_Reduce<4, false>)->UseRealTime();
+BENCHMARK(BM_Reduce<4, true>)->UseRealTime();
+
+BENCHMARK(BM_Pipeline<0>)->UseRealTime();
+BENCHMARK(BM_Pipeline<1>)->UseRealTime();
+BENCHMARK(BM_Pipeline<2>)->UseRealTime();
+
+BENCHMARK(BM_Pooled<4, true>)->ArgName("taskers")->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_Pooled<4, false>)->ArgName("taskers")->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "timer_wheel.h"
+
+namespace {
+
+// Schedules one item and cancels another while range(0) items are pending, spread over 10 minutes
+void BM_TimerWheel(benchmark::State& state)
+{
+    const auto pending = static_cast<std::size_t>(state.range(0));
+    const auto now = std::chrono::steady_clock::now();
+    std::minstd_rand random { 1 };
+    TimerWheel<int> wheel { std::chrono::milliseconds { 1 }, now };
+    std::vector<Timer> timers;
+
+    auto due = [&] { return now + std::chrono::milliseconds { random() % 600000 }; };
+
+    timers.reserve(pending);
+    for (std::size_t n = 0; n < pending; ++n)
+        timers.push_back(wheel.Schedule(due(), {}, 0));
+
+    for (auto _ : state) {
+        auto& timer = timers[random() % pending];
+
+        wheel.Cancel(timer);
+        timer = wheel.Schedule(due(), {}, 0);
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations()));
+}
+
+// Fires range(0) items spread over a minute, one tick at a time
+void BM_TimerWheelAdvance(benchmark::State& state)
+{
+    const auto count = static_cast<std::size_t>(state.range(0));
+    std::vector<int> due;
+
+    due.reserve(count);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+
+        const auto now = std::chrono::steady_clock::now();
+        std::minstd_rand random { 1 };
+        TimerWheel<int> wheel { std::chrono::milliseconds { 1 }, now };
+
+        for (std::size_t n = 0; n < count; ++n)
+            wheel.Schedule(now + std::chrono::milliseconds { random() % 60000 }, {}, 0);
+
+        state.ResumeTiming();
+
+        for (auto tick = std::chrono::milliseconds { 1 }; !wheel.Empty(); ++tick)
+            wheel.Advance(now + tick, std::back_inserter(due));
+
+        benchmark::DoNotOptimize(due.data());
+        due.clear();
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count));
+}
+
+} // namespace
+
+BENCHMARK(BM_TimerWheel)->ArgName("pending")->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_TimerWheelAdvance)->ArgName("timers")->RangeMultiplier(10)->Range(1000, 1000000);
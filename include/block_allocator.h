@@ -0,0 +1,162 @@
+#ifndef BLOCK_ALLOCATOR_H_
+#define BLOCK_ALLOCATOR_H_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace detail {
+
+// Blocks given back by the containers of one queue, kept by size for the next allocation
+//
+// A deque only asks for two sizes, its chunks and its map, so a few bins cover it. Up to reserve blocks of
+// each size stay around, the rest and sizes without a bin go straight back to operator delete.
+class BlockCache {
+public:
+    static constexpr std::size_t kBins = 4;
+
+    explicit BlockCache(std::size_t reserve) noexcept
+        : reserve_ { reserve }
+    {
+    }
+
+    ~BlockCache()
+    {
+        for (auto& bin : bins_) {
+            while (auto* block = bin.head) {
+                bin.head = block->next;
+                ::operator delete(block, bin.bytes, bin.align);
+            }
+        }
+    }
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    void* Allocate(std::size_t bytes, std::align_val_t align)
+    {
+        {
+            std::lock_guard lock { mutex_ };
+
+            if (auto* bin = Find(bytes, align); bin && bin->head) {
+                auto* block = bin->head;
+
+                bin->head = block->next;
+                --bin->count;
+
+                return block;
+            }
+        }
+
+        return ::operator new(bytes, align);
+    }
+
+    void Deallocate(void* pointer, std::size_t bytes, std::align_val_t align) noexcept
+    {
+        if (bytes >= sizeof(Block)) {
+            std::lock_guard lock { mutex_ };
+
+            if (auto* bin = Find(bytes, align); bin && bin->count < reserve_) {
+                bin->head = ::new (pointer) Block { bin->head };
+                ++bin->count;
+
+                return;
+            }
+        }
+
+        ::operator delete(pointer, bytes, align);
+    }
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    struct Bin {
+        std::size_t bytes { 0 };
+        std::align_val_t align {};
+        std::size_t count { 0 };
+        Block* head { nullptr };
+    };
+
+    // The bin of that size, claiming a free one on first sight
+    Bin* Find(std::size_t bytes, std::align_val_t align) noexcept
+    {
+        for (auto& bin : bins_) {
+            if (bin.bytes == 0) {
+                bin.bytes = bytes;
+                bin.align = align;
+            }
+
+            if (bin.bytes == bytes && bin.align == align)
+                return &bin;
+        }
+
+        return nullptr;
+    }
+
+    std::size_t reserve_;
+    std::mutex mutex_;
+    std::array<Bin, kBins> bins_ {};
+};
+
+} // namespace detail
+
+// Allocator recycling the blocks of a container through a cache of its own
+//
+// Copies and rebinds share the cache, so the chunks of ConcurrentQueue<T, BlockAllocator<T>> are recycled per queue
+// and Reserve of each size stay warm once the queue shrinks, instead of going back to malloc under bursty load.
+template <typename T, std::size_t Reserve = 64>
+class BlockAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U>
+    struct rebind {
+        using other = BlockAllocator<U, Reserve>;
+    };
+
+    BlockAllocator()
+        : cache_ { std::make_shared<detail::BlockCache>(Reserve) }
+    {
+    }
+
+    // No moves, a moved-from container still allocates through its allocator
+    BlockAllocator(const BlockAllocator&) noexcept = default;
+    BlockAllocator& operator=(const BlockAllocator&) noexcept = default;
+
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U, Reserve>& other) noexcept
+        : cache_ { other.cache_ }
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(cache_->Allocate(count * sizeof(T), std::align_val_t { alignof(T) }));
+    }
+
+    void deallocate(T* pointer, std::size_t count) noexcept
+    {
+        cache_->Deallocate(pointer, count * sizeof(T), std::align_val_t { alignof(T) });
+    }
+
+    template <typename U>
+    bool operator==(const BlockAllocator<U, Reserve>& other) const noexcept
+    {
+        return cache_ == other.cache_;
+    }
+
+private:
+    template <typename U, std::size_t>
+    friend class BlockAllocator;
+
+    std::shared_ptr<detail::BlockCache> cache_;
+};
+
+#endif // BLOCK_ALLOCATOR_H_
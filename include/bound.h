@@ -0,0 +1,21 @@
+#ifndef BOUND_H_
+#define BOUND_H_
+
+#include <cstddef>
+
+// What a full queue does with one more item
+enum class Overflow {
+    Block, // Emplace waits for room, Offer fails
+    Reject, // Emplace and Offer fail
+    DropOldest, // Emplace and Offer evict the oldest item to make room
+};
+
+// Capacity of a queue, 0 being unbounded
+//
+// TryEmplace fails on a full queue whatever the overflow.
+struct Bound {
+    std::size_t capacity { 0 };
+    Overflow overflow { Overflow::Block };
+};
+
+#endif // BOUND_H_
@@ -1,62 +1,103 @@
 #ifndef CONCURRENT_QUEUE_H_
 #define CONCURRENT_QUEUE_H_
 
+#include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <queue>
+#include <ranges>
 #include <shared_mutex>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
-template <typename T>
+#include "bound.h"
+
+// Allocator goes to the deque holding the items, see BlockAllocator to recycle its chunks
+template <typename T, typename Allocator = std::allocator<T>>
 class ConcurrentQueue {
 public:
+    using value_type = T;
+    using allocator_type = Allocator;
+
+    template <typename U>
+    using rebind = ConcurrentQueue<U, typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+
     ConcurrentQueue() = default;
+
+    explicit ConcurrentQueue(Bound bound, const Allocator& allocator = Allocator {})
+        : bound_ { bound }
+        , queue_ { allocator }
+    {
+    }
+
     ~ConcurrentQueue() = default;
     ConcurrentQueue(const ConcurrentQueue&) = delete;
     ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
 
-    ConcurrentQueue(ConcurrentQueue&& other) noexcept(std::is_nothrow_move_assignable_v<std::queue<T>>)
+    ConcurrentQueue(ConcurrentQueue&& other) noexcept(std::is_nothrow_move_assignable_v<Container>)
     {
         std::lock_guard lock { other.mutex_ };
 
+        bound_ = other.bound_;
         queue_ = std::move(other.queue_);
+        UpdateSize();
+        other.UpdateSize();
     }
 
-    ConcurrentQueue& operator=(ConcurrentQueue&& other) noexcept(std::is_nothrow_move_assignable_v<std::queue<T>>)
+    ConcurrentQueue& operator=(ConcurrentQueue&& other) noexcept(std::is_nothrow_move_assignable_v<Container>)
     {
         assert(this != &other);
 
         {
             std::scoped_lock lock { mutex_, other.mutex_ };
 
+            bound_ = other.bound_;
             queue_ = std::move(other.queue_);
+            UpdateSize();
+            other.UpdateSize();
         }
 
+        // A consumer parked on the old items has to see the new ones
+        cv_.notify_all();
+        producer_cv_.notify_all();
+
         return *this;
     }
 
+    // Doesn't take the lock, so spinning consumers can poll it
     bool Empty() const
     {
-        std::shared_lock lock { mutex_ };
+        return Size() == 0;
+    }
 
-        return queue_.empty();
+    std::size_t Size() const
+    {
+        return size_.load(std::memory_order_relaxed);
     }
 
-    auto Size() const
+    std::size_t Capacity() const noexcept
     {
-        std::shared_lock lock { mutex_ };
+        return bound_.capacity;
+    }
 
-        return queue_.size();
+    // Items evicted to make room so far, which never get popped
+    std::size_t Dropped() const noexcept
+    {
+        return dropped_.load(std::memory_order_acquire);
     }
 
+    // Copies, see VisitFront() to only look at the item
     std::optional<T> Front() const
     {
         std::optional<T> value;
 
-        if (std::shared_lock lock { mutex_ }; !queue_.empty())
-            value.emplace(queue_.front());
+        VisitFront([&](const T& front) { value.emplace(front); });
 
         return value;
     }
@@ -65,12 +106,38 @@ public:
     {
         std::optional<T> value;
 
-        if (std::shared_lock lock { mutex_ }; !queue_.empty())
-            value.emplace(queue_.back());
+        VisitBack([&](const T& back) { value.emplace(back); });
 
         return value;
     }
 
+    // Calls function(const T&) on the oldest item in place under the shared lock, false if there is none
+    template <typename Function>
+    bool VisitFront(Function&& function) const
+    {
+        std::shared_lock lock { mutex_ };
+
+        if (queue_.empty())
+            return false;
+
+        std::invoke(function, queue_.front());
+
+        return true;
+    }
+
+    template <typename Function>
+    bool VisitBack(Function&& function) const
+    {
+        std::shared_lock lock { mutex_ };
+
+        if (queue_.empty())
+            return false;
+
+        std::invoke(function, queue_.back());
+
+        return true;
+    }
+
     void Stop()
     {
         {
@@ -80,57 +147,138 @@ public:
         }
 
         cv_.notify_all();
+        producer_cv_.notify_all();
     }
 
-    void Clear()
+    // Items are destroyed outside of the lock, in case that's where they queue more work
+    //
+    // The chunks they sat in go back through the allocator, which a BlockAllocator keeps for the queue.
+    // Returns how many items were dropped.
+    std::size_t Clear()
     {
-        std::lock_guard lock { mutex_ };
+        Container queue { queue_.get_allocator() };
+
+        {
+            std::lock_guard lock { mutex_ };
 
-        queue_ = {};
+            queue_.swap(queue);
+            UpdateSize();
+        }
+
+        producer_cv_.notify_all();
+
+        return queue.size();
     }
 
-    void Push(const T& value)
+    bool Push(const T& value)
     {
-        Emplace(value);
+        return Emplace(value);
     }
 
-    void Push(T&& value)
+    bool Push(T&& value)
     {
-        Emplace(std::move(value));
+        return Emplace(std::move(value));
     }
 
+    // Fails once the queue is stopped, or when it's full and rejects
     template <typename... Args>
-    void Emplace(Args&&... args)
+    bool Emplace(Args&&... args)
     {
-        {
-            std::lock_guard lock { mutex_ };
+        std::unique_lock lock { mutex_ };
 
-            if (done_)
-                return;
+        return EmplaceLocked(lock, true, true, std::forward<Args>(args)...);
+    }
 
-            queue_.emplace(std::forward<Args>(args)...);
-        }
+    // Like Emplace but fails instead of blocking when the queue is full
+    template <typename... Args>
+    bool Offer(Args&&... args)
+    {
+        std::unique_lock lock { mutex_ };
 
-        cv_.notify_one();
+        return EmplaceLocked(lock, false, true, std::forward<Args>(args)...);
     }
 
-    std::optional<T> Pop()
+    // Pushes [first, last) under a single lock with a single wake-up, unless it has to wait for room in between
+    //
+    // Returns how many items went in, the rest being rejected.
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PushBulk(InputIt first, Sentinel last)
     {
-        std::optional<T> value;
+        std::size_t count = 0;
+        std::size_t sleepers = 0;
+        std::vector<T> evicted;
 
         {
             std::unique_lock lock { mutex_ };
-            cv_.wait(lock, [this] { return done_ || !queue_.empty(); });
 
-            if (!queue_.empty()) {
-                value.emplace(std::move(queue_.front()));
-                queue_.pop();
+            for (; first != last && Reserve(lock, true, true); ++first, ++count) {
+                if (Full()) {
+                    evicted.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                    dropped_.fetch_add(1, std::memory_order_release);
+                }
+
+                queue_.emplace_back(*first);
+                UpdateSize();
             }
+
+            sleepers = sleepers_;
         }
 
+        if (sleepers == 0 || count == 0)
+            return count;
+        else if (sleepers == 1 || count == 1)
+            cv_.notify_one();
+        else
+            cv_.notify_all();
+
+        return count;
+    }
+
+    template <std::ranges::input_range Range>
+    std::size_t PushRange(Range&& range)
+    {
+        return PushBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    std::optional<T> Pop()
+    {
+        std::optional<T> value;
+
+        PopWith([&](T&& item) { value.emplace(std::move(item)); });
+
         return value;
     }
 
+    // Moves the oldest item straight into out, false once stopped and drained
+    bool Pop(T& out)
+    {
+        return PopWith([&](T&& item) { out = std::move(item); });
+    }
+
+    // Blocks while the queue is empty, then calls function(T&&) on the oldest item in place and pops it
+    //
+    // It runs under the lock, so it should do little more than move the item out. Throwing leaves the item queued.
+    // Returns false once stopped and drained.
+    template <typename Function>
+    bool PopWith(Function&& function)
+    {
+        std::unique_lock lock { mutex_ };
+        Sleep(lock);
+
+        return PopLocked(lock, function);
+    }
+
+    // Blocks until there is at least one item, then moves up to max items into out under a single lock
+    template <typename OutputIt>
+    std::size_t PopBulk(OutputIt out, std::size_t max)
+    {
+        std::unique_lock lock { mutex_ };
+        Sleep(lock);
+
+        return PopLocked(lock, out, max);
+    }
+
     bool TryPush(const T& value)
     {
         return TryEmplace(value);
@@ -141,42 +289,183 @@ public:
         return TryEmplace(std::move(value));
     }
 
+    // Fails when the lock is taken or the queue is full, whatever the overflow, and never evicts
     template <typename... Args>
     bool TryEmplace(Args&&... args)
     {
-        {
-            std::unique_lock lock { mutex_, std::try_to_lock };
+        std::unique_lock lock { mutex_, std::try_to_lock };
 
-            if (!lock)
-                return false;
-            else if (done_)
+        if (!lock)
+            return false;
+
+        return EmplaceLocked(lock, false, false, std::forward<Args>(args)...);
+    }
+
+    std::optional<T> TryPop()
+    {
+        std::optional<T> value;
+
+        TryPopWith([&](T&& item) { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    bool TryPop(T& out)
+    {
+        return TryPopWith([&](T&& item) { out = std::move(item); });
+    }
+
+    // Like PopWith but fails when the lock is taken or the queue is empty
+    template <typename Function>
+    bool TryPopWith(Function&& function)
+    {
+        if (std::unique_lock lock { mutex_, std::try_to_lock }; lock)
+            return PopLocked(lock, function);
+
+        return false;
+    }
+
+    template <typename OutputIt>
+    std::size_t TryPopBulk(OutputIt out, std::size_t max)
+    {
+        if (std::unique_lock lock { mutex_, std::try_to_lock }; lock)
+            return PopLocked(lock, out, max);
+
+        return 0;
+    }
+
+private:
+    bool Full() const
+    {
+        return bound_.capacity != 0 && queue_.size() >= bound_.capacity;
+    }
+
+    // Waits for room if the bound says so, false if the item is rejected or the queue is stopped
+    //
+    // A full DropOldest queue passes when evict is set, leaving the eviction to the caller.
+    template <typename Lock>
+    bool Reserve(Lock& lock, bool wait, bool evict)
+    {
+        if (Full() && !(evict && bound_.overflow == Overflow::DropOldest)) {
+            if (!wait || bound_.overflow != Overflow::Block)
                 return false;
 
-            queue_.emplace(std::forward<Args>(args)...);
+            while (!done_ && Full()) {
+                // Consumers might sleep through a bulk push that stopped halfway
+                if (sleepers_ != 0)
+                    cv_.notify_all();
+
+                ++producers_;
+                producer_cv_.wait(lock);
+                --producers_;
+            }
         }
 
-        cv_.notify_one();
+        return !done_;
+    }
+
+    // The evicted item is destroyed outside of the lock, in case that's where it queues more work
+    template <typename Lock, typename... Args>
+    bool EmplaceLocked(Lock& lock, bool wait, bool evict, Args&&... args)
+    {
+        std::optional<T> evicted;
+
+        if (!Reserve(lock, wait, evict))
+            return false;
+
+        if (Full()) {
+            evicted.emplace(std::move(queue_.front()));
+            queue_.pop_front();
+            dropped_.fetch_add(1, std::memory_order_release);
+        }
+
+        queue_.emplace_back(std::forward<Args>(args)...);
+        UpdateSize();
+
+        const auto notify = sleepers_ != 0;
+
+        lock.unlock();
+
+        if (notify)
+            cv_.notify_one();
 
         return true;
     }
 
-    std::optional<T> TryPop()
+    // Counts sleeping consumers so that producers skip the notification when nobody waits
+    template <typename Lock>
+    void Sleep(Lock& lock)
     {
-        std::optional<T> value;
+        while (!done_ && queue_.empty()) {
+            ++sleepers_;
+            cv_.wait(lock);
+            --sleepers_;
+        }
+    }
+
+    void UpdateSize()
+    {
+        size_.store(queue_.size(), std::memory_order_relaxed);
+    }
+
+    template <typename Lock, typename Function>
+    bool PopLocked(Lock& lock, Function& function)
+    {
+        if (queue_.empty())
+            return false;
 
-        if (std::unique_lock lock { mutex_, std::try_to_lock }; lock && !queue_.empty()) {
-            value.emplace(std::move(queue_.front()));
-            queue_.pop();
+        std::invoke(function, std::move(queue_.front()));
+        queue_.pop_front();
+        UpdateSize();
+
+        const auto notify = producers_ != 0;
+
+        lock.unlock();
+
+        if (notify)
+            producer_cv_.notify_one();
+
+        return true;
+    }
+
+    template <typename Lock, typename OutputIt>
+    std::size_t PopLocked(Lock& lock, OutputIt& out, std::size_t max)
+    {
+        std::size_t count = 0;
+
+        for (; count < max && !queue_.empty(); ++count) {
+            *out++ = std::move(queue_.front());
+            queue_.pop_front();
         }
 
-        return value;
+        UpdateSize();
+
+        const auto producers = producers_;
+
+        lock.unlock();
+
+        if (producers == 0 || count == 0)
+            return count;
+        else if (producers == 1 || count == 1)
+            producer_cv_.notify_one();
+        else
+            producer_cv_.notify_all();
+
+        return count;
     }
 
-private:
+    Bound bound_ {};
     bool done_ { false };
-    std::queue<T> queue_;
+    std::size_t sleepers_ { 0 };
+    std::size_t producers_ { 0 };
+    std::atomic_size_t size_ { 0 };
+    std::atomic_size_t dropped_ { 0 };
+    using Container = std::deque<T, Allocator>;
+
+    Container queue_;
     mutable std::shared_mutex mutex_;
     std::condition_variable_any cv_;
+    std::condition_variable_any producer_cv_;
 };
 
 #endif // CONCURRENT_QUEUE_H_
\ No newline at end of file
@@ -0,0 +1,264 @@
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "job.h"
+
+namespace detail {
+
+// Awaiter of Tasker::Schedule(), which lives in the coroutine frame and goes into the queue as a job
+//
+// push(Job*) hands it over to the workers and fails once the Tasker is stopped, in which case the coroutine
+// continues on the calling thread and co_await throws. It's also resumed on whichever thread discards it
+// (e.g. Clear()), throwing the same way.
+template <typename Push>
+class Hop final : public Job {
+public:
+    explicit Hop(Push push) noexcept
+        : Job { Kind::Resume }
+        , push_ { std::move(push) }
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+
+        // Another worker may resume the coroutine and destroy *this as soon as it's pushed
+        if (push_(static_cast<Job*>(this)))
+            return true;
+
+        abandoned_ = true;
+
+        return false;
+    }
+
+    void await_resume() const
+    {
+        if (abandoned_)
+            throw std::future_error { std::future_errc::broken_promise };
+    }
+
+    void Resume() override
+    {
+        handle_.resume();
+    }
+
+    void Abandon() noexcept override
+    {
+        abandoned_ = true;
+        handle_.resume();
+    }
+
+private:
+    Push push_;
+    std::coroutine_handle<> handle_;
+    bool abandoned_ { false };
+};
+
+// Lets Coroutine<T>::Get() block the caller until the coroutine is done
+struct Rendezvous {
+    void Notify()
+    {
+        std::lock_guard lock { mutex };
+
+        done = true;
+        cv.notify_one();
+    }
+
+    void Wait()
+    {
+        std::unique_lock lock { mutex };
+
+        cv.wait(lock, [this] { return done; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done { false };
+};
+
+template <typename T>
+class CoroutineResult {
+public:
+    template <typename U = T>
+    void return_value(U&& value)
+    {
+        value_.emplace(std::forward<U>(value));
+    }
+
+protected:
+    T Take()
+    {
+        return *std::move(value_);
+    }
+
+private:
+    std::optional<T> value_;
+};
+
+template <>
+class CoroutineResult<void> {
+public:
+    void return_void() noexcept { }
+
+protected:
+    void Take() noexcept { }
+};
+
+} // namespace detail
+
+// Lazily started coroutine returning T
+//
+// co_await runs it on the awaiting thread and resumes the awaiter right where it finishes (symmetric transfer),
+// so a coroutine that hops onto a Tasker with co_await tasker.Schedule() hands its workers over to its awaiter.
+// Get() drives it from a thread outside of any coroutine.
+template <typename T = void>
+class [[nodiscard]] Coroutine {
+public:
+    class promise_type : public detail::CoroutineResult<T> {
+    public:
+        Coroutine get_return_object() noexcept
+        {
+            return Coroutine { std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct Final {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    auto& promise = handle.promise();
+
+                    if (promise.continuation_)
+                        return promise.continuation_;
+
+                    promise.rendezvous_->Notify();
+
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept { }
+            };
+
+            return Final {};
+        }
+
+        void unhandled_exception() noexcept
+        {
+            error_ = std::current_exception();
+        }
+
+    private:
+        friend class Coroutine;
+
+        T Result()
+        {
+            if (error_)
+                std::rethrow_exception(error_);
+
+            return this->Take();
+        }
+
+        std::coroutine_handle<> continuation_;
+        detail::Rendezvous* rendezvous_ { nullptr };
+        std::exception_ptr error_;
+    };
+
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+
+    Coroutine(Coroutine&& other) noexcept
+        : handle_ { std::exchange(other.handle_, nullptr) }
+    {
+    }
+
+    Coroutine& operator=(Coroutine&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle_)
+                handle_.destroy();
+
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+
+        return *this;
+    }
+
+    ~Coroutine()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                handle.promise().continuation_ = continuation;
+
+                return handle;
+            }
+
+            T await_resume()
+            {
+                return handle.promise().Result();
+            }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        return Awaiter { handle_ };
+    }
+
+    // Runs it to completion, blocking while it's away on workers
+    T Get() &&
+    {
+        detail::Rendezvous rendezvous;
+
+        handle_.promise().rendezvous_ = &rendezvous;
+        handle_.resume();
+        rendezvous.Wait();
+
+        return handle_.promise().Result();
+    }
+
+private:
+    explicit Coroutine(std::coroutine_handle<promise_type> handle) noexcept
+        : handle_ { handle }
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+#endif // COROUTINE_H_
@@ -0,0 +1,454 @@
+#ifndef EVENT_QUEUE_H_
+#define EVENT_QUEUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include "bound.h"
+#include "concurrent_queue.h"
+#include "platform.h"
+#include "wait_policy.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define TASKER_HAS_EPOLL
+#endif
+
+// Readiness of file descriptors, waited for together with a wake-up from other threads
+//
+// On Linux it's an epoll instance with an eventfd registered, so Wake() ends a Wait() like any other event.
+// Elsewhere it only waits for Wake() and Watch() fails. Handlers run on the thread calling Wait(), one at a time.
+class EventLoop {
+public:
+    // Gets the events epoll reported, EPOLLIN and friends
+    using Handler = std::function<void(std::uint32_t)>;
+
+    EventLoop()
+    {
+#if defined(TASKER_HAS_EPOLL)
+        epoll_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        epoll_event event {};
+
+        event.events = EPOLLIN;
+        event.data.fd = wake_;
+
+        if (epoll_ < 0 || wake_ < 0 || epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event) != 0) {
+            const auto error = errno;
+
+            Close();
+
+            throw std::system_error { error, std::system_category(), "EventLoop" };
+        }
+#endif
+    }
+
+    ~EventLoop()
+    {
+        Close();
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    EventLoop(EventLoop&&) = delete;
+    EventLoop& operator=(EventLoop&&) = delete;
+
+    // Calls handler with what fd is ready for from now on, level-triggered unless events has EPOLLET
+    //
+    // May be called from any thread, false if fd is already watched or epoll refuses it.
+    bool Watch(int fd, std::uint32_t events, Handler handler)
+    {
+#if defined(TASKER_HAS_EPOLL)
+        std::lock_guard lock { mutex_ };
+
+        if (handlers_.contains(fd))
+            return false;
+
+        epoll_event event {};
+
+        event.events = events;
+        event.data.fd = fd;
+
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0)
+            return false;
+
+        handlers_.emplace(fd, std::make_shared<Handler>(std::move(handler)));
+
+        return true;
+#else
+        (void)fd;
+        (void)events;
+        (void)handler;
+
+        return false;
+#endif
+    }
+
+    // A handler already running finishes, fd has to stay open until this returns
+    bool Unwatch(int fd)
+    {
+#if defined(TASKER_HAS_EPOLL)
+        std::lock_guard lock { mutex_ };
+
+        if (handlers_.erase(fd) == 0)
+            return false;
+
+        epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+
+        return true;
+#else
+        (void)fd;
+
+        return false;
+#endif
+    }
+
+    // Ends the current or next Wait(), from any thread
+    void Wake() noexcept
+    {
+#if defined(TASKER_HAS_EPOLL)
+        const std::uint64_t one = 1;
+
+        // Only fails once the counter is about to overflow, which wakes the loop anyway
+        [[maybe_unused]] const auto written = write(wake_, &one, sizeof(one));
+#else
+        {
+            std::lock_guard lock { mutex_ };
+
+            woken_ = true;
+        }
+
+        cv_.notify_one();
+#endif
+    }
+
+    // Blocks up to timeout milliseconds, -1 for ever, until an fd is ready or Wake() is called
+    //
+    // Runs the handlers of whatever is ready and returns how many ran. A timeout of 0 only polls.
+    std::size_t Wait(int timeout)
+    {
+        std::size_t count = 0;
+
+#if defined(TASKER_HAS_EPOLL)
+        epoll_event events[kEvents];
+        const auto ready = epoll_wait(epoll_, events, kEvents, timeout);
+
+        for (int n = 0; n < ready; ++n) {
+            if (events[n].data.fd == wake_) {
+                std::uint64_t value = 0;
+
+                [[maybe_unused]] const auto drained = read(wake_, &value, sizeof(value));
+                continue;
+            }
+
+            std::shared_ptr<Handler> handler;
+
+            {
+                std::lock_guard lock { mutex_ };
+
+                if (auto found = handlers_.find(events[n].data.fd); found != handlers_.end())
+                    handler = found->second;
+            }
+
+            // Unwatched since epoll reported it
+            if (!handler)
+                continue;
+
+            (*handler)(events[n].events);
+            ++count;
+        }
+#else
+        std::unique_lock lock { mutex_ };
+        auto woken = [this] { return woken_; };
+
+        if (timeout < 0)
+            cv_.wait(lock, woken);
+        else
+            cv_.wait_for(lock, std::chrono::milliseconds { timeout }, woken);
+
+        woken_ = false;
+#endif
+
+        return count;
+    }
+
+private:
+    static constexpr int kEvents = 64;
+
+    void Close() noexcept
+    {
+#if defined(TASKER_HAS_EPOLL)
+        if (wake_ >= 0)
+            close(wake_);
+
+        if (epoll_ >= 0)
+            close(epoll_);
+#endif
+    }
+
+    std::mutex mutex_;
+
+#if defined(TASKER_HAS_EPOLL)
+    int epoll_ { -1 };
+    int wake_ { -1 };
+    std::unordered_map<int, std::shared_ptr<Handler>> handlers_;
+#else
+    std::condition_variable cv_;
+    bool woken_ { false };
+#endif
+};
+
+// ConcurrentQueue whose consumer parks in an EventLoop instead of on a condition variable
+//
+// A worker parked on it runs I/O handlers as fds get ready, and posting wakes it through the loop's eventfd, so
+// completions and posted items are handled on the same thread without a hop through another queue. Under load,
+// blocking pops also poll the loop every kPollInterval items. Only the owning worker may pop blocking, which is
+// what Tasker does: with N = 1 on every item, with more workers whenever one runs out of work.
+template <typename T, typename Allocator = std::allocator<T>>
+class EventQueue {
+    using Storage = ConcurrentQueue<T, Allocator>;
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+
+    template <typename U>
+    using rebind = EventQueue<U, typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+
+    static constexpr std::size_t kPollInterval = 64;
+
+    EventQueue() = default;
+
+    explicit EventQueue(Bound bound, const Allocator& allocator = Allocator {})
+        : queue_ { bound, allocator }
+    {
+    }
+
+    // Not movable, a consumer may be parked on the loop and the fds stay watched on it
+    ~EventQueue() = default;
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+    EventQueue(EventQueue&&) = delete;
+    EventQueue& operator=(EventQueue&&) = delete;
+
+    // Where to watch fds whose readiness the consumer handles
+    EventLoop& Events() noexcept
+    {
+        return loop_;
+    }
+
+    bool Empty() const
+    {
+        return queue_.Empty();
+    }
+
+    std::size_t Size() const
+    {
+        return queue_.Size();
+    }
+
+    std::size_t Capacity() const noexcept
+    {
+        return queue_.Capacity();
+    }
+
+    std::size_t Dropped() const noexcept
+    {
+        return queue_.Dropped();
+    }
+
+    void Stop()
+    {
+        queue_.Stop();
+        done_.store(true, std::memory_order_seq_cst);
+        loop_.Wake();
+    }
+
+    std::size_t Clear()
+    {
+        return queue_.Clear();
+    }
+
+    bool Push(const T& value)
+    {
+        return Emplace(value);
+    }
+
+    bool Push(T&& value)
+    {
+        return Emplace(std::move(value));
+    }
+
+    template <typename... Args>
+    bool Emplace(Args&&... args)
+    {
+        return Notify(queue_.Emplace(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    bool Offer(Args&&... args)
+    {
+        return Notify(queue_.Offer(std::forward<Args>(args)...));
+    }
+
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PushBulk(InputIt first, Sentinel last)
+    {
+        const auto count = queue_.PushBulk(first, last);
+
+        Notify(count != 0);
+
+        return count;
+    }
+
+    template <std::ranges::input_range Range>
+    std::size_t PushRange(Range&& range)
+    {
+        return PushBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    bool TryPush(const T& value)
+    {
+        return TryEmplace(value);
+    }
+
+    bool TryPush(T&& value)
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    template <typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        return Notify(queue_.TryEmplace(std::forward<Args>(args)...));
+    }
+
+    // Blocks while the queue is empty, handling I/O meanwhile, returns std::nullopt once stopped and drained
+    std::optional<T> Pop()
+    {
+        std::optional<T> value;
+
+        PopWith([&](T&& item) { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    bool Pop(T& out)
+    {
+        return PopWith([&](T&& item) { out = std::move(item); });
+    }
+
+    template <typename Function>
+    bool PopWith(Function&& function)
+    {
+        auto popped = false;
+
+        Wait([&] { return popped = queue_.TryPopWith(function); });
+
+        return popped;
+    }
+
+    template <typename OutputIt>
+    std::size_t PopBulk(OutputIt out, std::size_t max)
+    {
+        std::size_t count = 0;
+
+        Wait([&] { return (count = queue_.TryPopBulk(out, max)) != 0; });
+
+        return count;
+    }
+
+    std::optional<T> TryPop()
+    {
+        return queue_.TryPop();
+    }
+
+    bool TryPop(T& out)
+    {
+        return queue_.TryPop(out);
+    }
+
+    template <typename Function>
+    bool TryPopWith(Function&& function)
+    {
+        return queue_.TryPopWith(std::forward<Function>(function));
+    }
+
+    template <typename OutputIt>
+    std::size_t TryPopBulk(OutputIt out, std::size_t max)
+    {
+        return queue_.TryPopBulk(out, max);
+    }
+
+private:
+    // Wakes the consumer if it's parked in the loop, pairs with the heavy fence in Wait()
+    bool Notify(bool pushed)
+    {
+        if (!pushed)
+            return pushed;
+
+        detail::LightFence();
+
+        if (parked_.load(std::memory_order_relaxed))
+            loop_.Wake();
+
+        return pushed;
+    }
+
+    // Runs pop() until it succeeds or the queue is stopped and drained, parking in the loop while it's empty
+    template <typename Pop>
+    void Wait(Pop pop)
+    {
+        if (++pops_ % kPollInterval == 0)
+            loop_.Wait(0);
+
+        while (!pop()) {
+            // The lock was taken, not worth parking for
+            if (!queue_.Empty()) {
+                CpuRelax();
+                continue;
+            }
+
+            // Pushes fail once the storage is stopped, which comes before done_, so an empty queue seen now stays empty
+            if (done_.load(std::memory_order_seq_cst)) {
+                if (queue_.Empty())
+                    return;
+
+                continue;
+            }
+
+            parked_.store(true, std::memory_order_relaxed);
+            detail::HeavyFence();
+
+            if (queue_.Empty() && !done_.load(std::memory_order_relaxed))
+                loop_.Wait(-1);
+
+            parked_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    Storage queue_;
+    EventLoop loop_;
+    std::size_t pops_ { 0 }; // Consumer only
+    std::atomic_bool parked_ { false };
+    std::atomic_bool done_ { false };
+};
+
+#endif // EVENT_QUEUE_H_
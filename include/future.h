@@ -0,0 +1,458 @@
+#ifndef FUTURE_H_
+#define FUTURE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "job.h"
+#include "platform.h"
+
+template <typename R>
+class Future;
+
+namespace detail {
+
+// Fixed size blocks recycled through a free list
+//
+// Blocks may outlive the owner: Detach() hands the pool over to its outstanding blocks
+// and the last one to be freed deletes it.
+class BlockPool {
+public:
+    static constexpr std::size_t kBlocksPerChunk = 64;
+
+    static BlockPool* Create(std::size_t block_size)
+    {
+        return new BlockPool { block_size };
+    }
+
+    std::size_t BlockSize() const noexcept
+    {
+        return block_size_;
+    }
+
+    void* Allocate()
+    {
+        std::lock_guard lock { mutex_ };
+
+        if (!free_) {
+            auto& chunk = chunks_.emplace_back(static_cast<std::byte*>(::operator new(block_size_ * kBlocksPerChunk, std::align_val_t { kCacheLineSize })));
+
+            for (std::size_t n = kBlocksPerChunk; n-- > 0;)
+                free_ = ::new (static_cast<void*>(chunk.get() + n * block_size_)) Free { free_ };
+        }
+
+        ++outstanding_;
+
+        return std::exchange(free_, free_->next);
+    }
+
+    void Deallocate(void* block) noexcept
+    {
+        bool last = false;
+
+        {
+            std::lock_guard lock { mutex_ };
+
+            free_ = ::new (block) Free { free_ };
+            last = --outstanding_ == 0 && detached_;
+        }
+
+        if (last)
+            delete this;
+    }
+
+    void Detach() noexcept
+    {
+        bool last = false;
+
+        {
+            std::lock_guard lock { mutex_ };
+
+            detached_ = true;
+            last = outstanding_ == 0;
+        }
+
+        if (last)
+            delete this;
+    }
+
+private:
+    struct Free {
+        Free* next;
+    };
+
+    struct ChunkDeleter {
+        void operator()(std::byte* chunk) const noexcept
+        {
+            ::operator delete(chunk, std::align_val_t { kCacheLineSize });
+        }
+    };
+
+    explicit BlockPool(std::size_t block_size)
+        : block_size_ { (std::max(block_size, sizeof(Free)) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize }
+    {
+    }
+
+    const std::size_t block_size_;
+    std::mutex mutex_;
+    Free* free_ { nullptr };
+    std::size_t outstanding_ { 0 };
+    bool detached_ { false };
+    std::vector<std::unique_ptr<std::byte, ChunkDeleter>> chunks_;
+};
+
+// Shared state between a worker and a Future, referenced by both until each side lets go
+template <typename R>
+class FutureState final : public Job {
+public:
+    static constexpr std::size_t kInlineSize = 48;
+
+    // From pool when it fits, from the heap otherwise
+    static FutureState* Make(BlockPool* pool, Kind kind)
+    {
+        if (pool && sizeof(FutureState) <= pool->BlockSize() && alignof(FutureState) <= kCacheLineSize)
+            return ::new (pool->Allocate()) FutureState { pool, kind };
+
+        return new FutureState { nullptr, kind };
+    }
+
+    void Abandon() noexcept override
+    {
+        SetException(std::make_exception_ptr(std::future_error { std::future_errc::broken_promise }));
+    }
+
+    template <typename... Args>
+    void SetValue(Args&&... args)
+    {
+        if constexpr (!std::is_void_v<R>)
+            value_.emplace(std::forward<Args>(args)...);
+
+        Complete();
+    }
+
+    void SetException(std::exception_ptr error) noexcept
+    {
+        error_ = std::move(error);
+
+        Complete();
+    }
+
+    bool Ready() const noexcept
+    {
+        return status_.load(std::memory_order_acquire) == kReady;
+    }
+
+    void Wait() const noexcept
+    {
+        for (auto status = status_.load(std::memory_order_acquire); status != kReady; status = status_.load(std::memory_order_acquire))
+            status_.wait(status, std::memory_order_acquire);
+    }
+
+    R Get()
+    {
+        Wait();
+
+        if (error_)
+            std::rethrow_exception(error_);
+
+        if constexpr (!std::is_void_v<R>)
+            return *std::move(value_);
+    }
+
+    // Runs function(*this) right where the result is set, or inline when it's already there,
+    // and drops the reference of the Future it replaces
+    template <typename Function>
+    void Continue(Function function)
+    {
+        if constexpr (sizeof(Function) <= kInlineSize && alignof(Function) <= alignof(std::max_align_t)) {
+            ::new (static_cast<void*>(continuation_)) Function(std::move(function));
+            invoke_ = [](FutureState& state) {
+                auto* continuation = std::launder(reinterpret_cast<Function*>(state.continuation_));
+
+                (*continuation)(state);
+                continuation->~Function();
+                state.Release();
+            };
+        } else {
+            ::new (static_cast<void*>(continuation_)) Function*(new Function(std::move(function)));
+            invoke_ = [](FutureState& state) {
+                std::unique_ptr<Function> continuation { *std::launder(reinterpret_cast<Function**>(state.continuation_)) };
+
+                (*continuation)(state);
+                continuation.reset();
+                state.Release();
+            };
+        }
+
+        auto expected = kPending;
+
+        if (!status_.compare_exchange_strong(expected, kContinued, std::memory_order_acq_rel))
+            invoke_(*this);
+    }
+
+    BlockPool* Pool() const noexcept
+    {
+        return pool_;
+    }
+
+    bool HasError() const noexcept
+    {
+        return static_cast<bool>(error_);
+    }
+
+    std::exception_ptr Error() const noexcept
+    {
+        return error_;
+    }
+
+    std::conditional_t<std::is_void_v<R>, std::nullptr_t, std::optional<R>>& Value() noexcept
+    {
+        return value_;
+    }
+
+    void Release() noexcept
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        if (auto* pool = pool_) {
+            this->~FutureState();
+            pool->Deallocate(this);
+        } else {
+            delete this;
+        }
+    }
+
+private:
+    static constexpr std::uint32_t kPending = 0;
+    static constexpr std::uint32_t kContinued = 1;
+    static constexpr std::uint32_t kReady = 2;
+
+    FutureState(BlockPool* pool, Kind kind) noexcept
+        : Job { kind }
+        , pool_ { pool }
+    {
+    }
+
+    ~FutureState() = default;
+
+    // Drops the reference of whoever produced the result
+    void Complete() noexcept
+    {
+        if (status_.exchange(kReady, std::memory_order_acq_rel) == kContinued)
+            invoke_(*this);
+        else
+            status_.notify_all();
+
+        Release();
+    }
+
+    BlockPool* const pool_;
+    std::atomic_uint32_t status_ { kPending };
+    std::atomic_uint32_t refs_ { 2 };
+    void (*invoke_)(FutureState&) { nullptr };
+    std::exception_ptr error_;
+    [[no_unique_address]] std::conditional_t<std::is_void_v<R>, std::nullptr_t, std::optional<R>> value_ {};
+    alignas(std::max_align_t) std::byte continuation_[kInlineSize];
+};
+
+template <typename R>
+const void* TypeId() noexcept
+{
+    static constexpr char id {};
+
+    return &id;
+}
+
+// Future states of one Tasker, whose processing function returns the expected result type
+class FuturePool {
+public:
+    FuturePool() = default;
+    FuturePool(const FuturePool&) = delete;
+    FuturePool& operator=(const FuturePool&) = delete;
+
+    ~FuturePool()
+    {
+        if (pool_)
+            pool_->Detach();
+    }
+
+    template <typename R>
+    void Expect()
+    {
+        result_ = TypeId<R>();
+
+        if (!pool_)
+            pool_ = BlockPool::Create(std::max(sizeof(FutureState<R>), sizeof(FutureState<void>)));
+    }
+
+    // Future<void> works with any result, which is discarded
+    template <typename R>
+    FutureState<R>* Make()
+    {
+        assert((std::is_void_v<R> || result_ == TypeId<R>()) && "R must be the result type of the processing function");
+
+        return FutureState<R>::Make(pool_, std::is_void_v<R> ? Job::Kind::Signal : Job::Kind::Complete);
+    }
+
+    BlockPool* Pool() const noexcept
+    {
+        return pool_;
+    }
+
+private:
+    const void* result_ { nullptr };
+    BlockPool* pool_ { nullptr };
+};
+
+template <typename R>
+Future<R> MakeFuture(FutureState<R>* state) noexcept;
+
+} // namespace detail
+
+// Result of Tasker::Submit
+//
+// Move-only and single-shot: Get() or Then() consume it. It may outlive its Tasker, although a Tasker that gets
+// destroyed with the submitted item still queued (e.g. by Clear()) fails it with std::future_errc::broken_promise.
+template <typename R>
+class Future {
+public:
+    Future() = default;
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    Future(Future&& other) noexcept
+        : state_ { std::exchange(other.state_, nullptr) }
+    {
+    }
+
+    Future& operator=(Future&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            state_ = std::exchange(other.state_, nullptr);
+        }
+
+        return *this;
+    }
+
+    ~Future()
+    {
+        Reset();
+    }
+
+    bool Valid() const noexcept
+    {
+        return state_ != nullptr;
+    }
+
+    bool Ready() const noexcept
+    {
+        assert(Valid());
+
+        return state_->Ready();
+    }
+
+    void Wait() const noexcept
+    {
+        assert(Valid());
+
+        state_->Wait();
+    }
+
+    R Get()
+    {
+        assert(Valid());
+
+        std::unique_ptr<detail::FutureState<R>, Releaser> state { std::exchange(state_, nullptr) };
+
+        return state->Get();
+    }
+
+    // Chains function(R) (or function() for void) to run on the worker that produces the result, without queueing
+    // it again. If the result is already there, it runs right away on the calling thread. Exceptions skip function
+    // and propagate to the returned Future.
+    template <typename Function>
+    auto Then(Function function)
+    {
+        assert(Valid());
+
+        using U = typename std::conditional_t<std::is_void_v<R>, std::invoke_result<Function>, std::invoke_result<Function, R>>::type;
+
+        auto* pool = state_->Pool();
+        auto* next = detail::FutureState<U>::Make(pool, detail::Job::Kind::Complete);
+
+        std::exchange(state_, nullptr)->Continue([next, function = std::move(function)](detail::FutureState<R>& state) mutable {
+            if (state.HasError()) {
+                next->SetException(state.Error());
+                return;
+            }
+
+            try {
+                if constexpr (std::is_void_v<R> && std::is_void_v<U>) {
+                    function();
+                    next->SetValue();
+                } else if constexpr (std::is_void_v<R>) {
+                    next->SetValue(function());
+                } else if constexpr (std::is_void_v<U>) {
+                    function(*std::move(state.Value()));
+                    next->SetValue();
+                } else {
+                    next->SetValue(function(*std::move(state.Value())));
+                }
+            } catch (...) {
+                next->SetException(std::current_exception());
+            }
+        });
+
+        return detail::MakeFuture(next);
+    }
+
+private:
+    template <typename U>
+    friend Future<U> detail::MakeFuture(detail::FutureState<U>* state) noexcept;
+
+    struct Releaser {
+        void operator()(detail::FutureState<R>* state) const noexcept
+        {
+            state->Release();
+        }
+    };
+
+    explicit Future(detail::FutureState<R>* state) noexcept
+        : state_ { state }
+    {
+    }
+
+    void Reset() noexcept
+    {
+        if (auto* state = std::exchange(state_, nullptr))
+            state->Release();
+    }
+
+    detail::FutureState<R>* state_ { nullptr };
+};
+
+namespace detail {
+
+template <typename R>
+Future<R> MakeFuture(FutureState<R>* state) noexcept
+{
+    return Future<R> { state };
+}
+
+} // namespace detail
+
+#endif // FUTURE_H_
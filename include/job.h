@@ -0,0 +1,176 @@
+#ifndef JOB_H_
+#define JOB_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "stats.h"
+#include "trace.h"
+
+namespace detail {
+
+// Work that rides along with a queued item, or replaces it
+//
+// Jobs are intrusive: they live wherever their owner put them (a pooled future state, a coroutine frame),
+// so scheduling one never allocates.
+class Job {
+public:
+    enum class Kind : std::uint8_t {
+        Complete, // Process the value and hand the result over
+        Signal, // Process the value and report completion only
+        Resume, // No value, just run the job
+    };
+
+    explicit Job(Kind kind) noexcept
+        : kind_ { kind }
+    {
+    }
+
+    Job(const Job&) = delete;
+    Job& operator=(const Job&) = delete;
+
+    Kind GetKind() const noexcept
+    {
+        return kind_;
+    }
+
+    virtual void Resume() { }
+
+    // The item carrying this job was discarded before a worker got to it
+    virtual void Abandon() noexcept = 0;
+
+protected:
+    ~Job() = default;
+
+private:
+    Kind kind_;
+};
+
+// What the queues actually hold: a value of T, a job, or both
+template <typename T>
+class Item {
+public:
+    // Neither a value nor a job, where a worker keeps the storage it pops into
+    Item() noexcept { }
+
+    template <typename... Args>
+    explicit Item(std::in_place_t, Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>)
+        : trace_ { TraceTag::Sample() }
+    {
+        ::new (static_cast<void*>(&value_)) T(std::forward<Args>(args)...);
+        has_value_ = true;
+    }
+
+    // For PushBulk, which constructs items straight from the posted values
+    template <typename U>
+        requires(!std::is_same_v<std::remove_cvref_t<U>, Item> && std::is_constructible_v<T, U &&>)
+    explicit Item(U&& value) noexcept(std::is_nothrow_constructible_v<T, U&&>)
+        : Item { std::in_place, std::forward<U>(value) }
+    {
+    }
+
+    explicit Item(Job* job) noexcept
+        : job_ { job }
+    {
+    }
+
+    Item(Item&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : job_ { std::exchange(other.job_, nullptr) }
+        , stamp_ { other.stamp_ }
+        , trace_ { other.trace_ }
+    {
+        // Trivial values are copied whether or not there is one, so that GCC doesn't lose track of them through
+        // the move assignments into a worker's item and warn that they may be read uninitialized
+        if constexpr (std::is_trivially_move_constructible_v<T> && std::is_trivially_destructible_v<T>) {
+            std::memcpy(static_cast<void*>(&value_), static_cast<const void*>(&other.value_), sizeof(T));
+            has_value_ = other.has_value_;
+        } else if (other.has_value_) {
+            ::new (static_cast<void*>(&value_)) T(std::move(other.value_));
+            has_value_ = true;
+        }
+    }
+
+    Item& operator=(Item&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this != &other) {
+            this->~Item();
+            ::new (static_cast<void*>(this)) Item(std::move(other));
+        }
+
+        return *this;
+    }
+
+    ~Item()
+    {
+        if (job_)
+            job_->Abandon();
+
+        if (has_value_)
+            value_.~T();
+    }
+
+    // Destroys the value right away instead of on the next assignment, the job has to be released already
+    void Reset() noexcept
+    {
+        assert(!job_);
+
+        if (has_value_) {
+            value_.~T();
+            has_value_ = false;
+        }
+    }
+
+    bool HasValue() const noexcept
+    {
+        return has_value_;
+    }
+
+    T& Value() noexcept
+    {
+        return value_;
+    }
+
+    const Stamp& GetStamp() const noexcept
+    {
+        return stamp_;
+    }
+
+    const TraceTag& GetTrace() const noexcept
+    {
+        return trace_;
+    }
+
+    Job* GetJob() const noexcept
+    {
+        return job_;
+    }
+
+    void Attach(Job* job) noexcept
+    {
+        job_ = job;
+    }
+
+    // Takes the job over, so that the item no longer abandons it
+    Job* Release() noexcept
+    {
+        return std::exchange(job_, nullptr);
+    }
+
+private:
+    Job* job_ { nullptr };
+    bool has_value_ { false };
+    [[no_unique_address]] Stamp stamp_ {};
+    [[no_unique_address]] TraceTag trace_ {};
+
+    union {
+        T value_;
+    };
+};
+
+} // namespace detail
+
+#endif // JOB_H_
@@ -0,0 +1,233 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace detail {
+
+// Body of ParallelFor, calling function on each element
+template <typename It, typename Function>
+struct ForEach {
+    struct Partial { };
+
+    void Fold(Partial&, std::size_t begin, std::size_t end)
+    {
+        for (; begin < end; ++begin)
+            std::invoke(function, first[static_cast<std::iter_difference_t<It>>(begin)]);
+    }
+
+    void Merge(Partial&&) noexcept { }
+
+    It first;
+    Function& function;
+};
+
+// Body of ParallelReduce, each chunk folds its own partial before merging it into total under the lock
+template <typename It, typename U, typename Reduce, typename Transform>
+struct Reduction {
+    using Partial = std::optional<U>;
+
+    void Fold(Partial& partial, std::size_t begin, std::size_t end)
+    {
+        for (; begin < end; ++begin) {
+            auto value = std::invoke(transform, first[static_cast<std::iter_difference_t<It>>(begin)]);
+
+            if (partial)
+                *partial = std::invoke(reduce, std::move(*partial), std::move(value));
+            else
+                partial.emplace(std::move(value));
+        }
+    }
+
+    void Merge(Partial&& partial)
+    {
+        if (!partial)
+            return;
+
+        std::lock_guard lock { mutex };
+
+        total = std::invoke(reduce, std::move(total), *std::move(partial));
+    }
+
+    It first;
+    Reduce& reduce;
+    Transform& transform;
+    U total;
+    std::mutex mutex {};
+};
+
+// Index range [0, size) that splits lazily, only as long as workers are idle to take the other half
+//
+// The calling thread starts with the whole range. Between grains, the part being run hands its upper half to post()
+// while hungry() counts more idle workers than halves waiting for one, so chunks stay as large as the load allows.
+// Halves nobody took yet are claimed back by the caller while it waits, which keeps nested loops on the workers
+// from waiting on queues that nobody serves.
+template <typename Body, typename Post, typename Hungry>
+class Splitter : public std::enable_shared_from_this<Splitter<Body, Post, Hungry>> {
+public:
+    // Body is built in place from args
+    template <typename... Args>
+    Splitter(std::size_t size, std::size_t grain, Post post, Hungry hungry, Args&&... args)
+        : size_ { size }
+        , grain_ { std::max<std::size_t>(grain, 1) }
+        , body_ { std::forward<Args>(args)... }
+        , post_ { std::move(post) }
+        , hungry_ { std::move(hungry) }
+    {
+    }
+
+    // Returns once every chunk went through, rethrowing the first exception
+    void Run()
+    {
+        Range(0, size_);
+
+        while (true) {
+            const auto pending = pending_.load(std::memory_order_acquire);
+
+            if (pending == 0)
+                break;
+
+            if (auto* chunk = Claim()) {
+                Range(chunk->begin, chunk->end);
+                Finish();
+            } else {
+                pending_.wait(pending, std::memory_order_acquire);
+            }
+        }
+
+        if (error_)
+            std::rethrow_exception(error_);
+    }
+
+    Body& GetBody() noexcept
+    {
+        return body_;
+    }
+
+private:
+    struct Chunk {
+        Chunk(std::size_t begin, std::size_t end) noexcept
+            : begin { begin }
+            , end { end }
+        {
+        }
+
+        std::size_t begin;
+        std::size_t end;
+        std::atomic_bool taken { false };
+    };
+
+    void Range(std::size_t begin, std::size_t end)
+    {
+        typename Body::Partial partial {};
+
+        try {
+            while (begin < end && !failed_.load(std::memory_order_relaxed)) {
+                while (end - begin > grain_ && hungry_() > queued_.load(std::memory_order_relaxed)) {
+                    const auto middle = begin + (end - begin) / 2;
+
+                    Spawn(middle, end);
+                    end = middle;
+                }
+
+                const auto stop = std::min(end, begin + grain_);
+
+                body_.Fold(partial, begin, stop);
+                begin = stop;
+            }
+
+            body_.Merge(std::move(partial));
+        } catch (...) {
+            Fail(std::current_exception());
+        }
+    }
+
+    // A chunk that didn't make it into a queue still gets claimed by the caller
+    void Spawn(std::size_t begin, std::size_t end)
+    {
+        Chunk* chunk = nullptr;
+
+        {
+            std::lock_guard lock { mutex_ };
+
+            chunk = &chunks_.emplace_back(begin, end);
+        }
+
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        pending_.fetch_add(1, std::memory_order_release);
+        pending_.notify_all();
+
+        post_([self = this->shared_from_this(), chunk] { self->Take(*chunk); });
+    }
+
+    // Run by a worker, unless the caller claimed the chunk first
+    void Take(Chunk& chunk)
+    {
+        if (chunk.taken.exchange(true, std::memory_order_acquire))
+            return;
+
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        Range(chunk.begin, chunk.end);
+        Finish();
+    }
+
+    Chunk* Claim()
+    {
+        std::lock_guard lock { mutex_ };
+
+        // Chunks before scan_ are all taken for good
+        for (; scan_ < chunks_.size(); ++scan_) {
+            auto& chunk = chunks_[scan_];
+
+            if (!chunk.taken.exchange(true, std::memory_order_acquire)) {
+                queued_.fetch_sub(1, std::memory_order_relaxed);
+                return &chunk;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void Finish()
+    {
+        pending_.fetch_sub(1, std::memory_order_release);
+        pending_.notify_all();
+    }
+
+    void Fail(std::exception_ptr error)
+    {
+        std::lock_guard lock { mutex_ };
+
+        if (!error_)
+            error_ = std::move(error);
+
+        failed_.store(true, std::memory_order_relaxed);
+    }
+
+    const std::size_t size_;
+    const std::size_t grain_;
+    Body body_;
+    Post post_;
+    Hungry hungry_;
+    std::atomic_size_t pending_ { 0 }; // Chunks spawned and not done yet
+    std::atomic_size_t queued_ { 0 }; // Chunks spawned and not taken yet
+    std::atomic_bool failed_ { false };
+    std::mutex mutex_;
+    std::deque<Chunk> chunks_;
+    std::size_t scan_ { 0 };
+    std::exception_ptr error_;
+};
+
+} // namespace detail
+
+#endif // PARALLEL_H_
@@ -0,0 +1,267 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "concurrent_queue.h"
+#include "ring_queue.h"
+#include "spsc_queue.h"
+#include "tasker.h"
+
+namespace detail {
+
+// Stage of a Pipeline, run by N workers of its own or, when fused, by the worker that ran the stage before it
+template <std::size_t N, bool Fused, typename Function>
+struct PipelineStage {
+    static constexpr std::size_t kWorkers = N;
+    static constexpr bool kFused = Fused;
+
+    Function function;
+    std::size_t capacity; // Items that may wait for the stage, 0 for the queue's default
+};
+
+// What a stage taking a single concrete argument takes, to deduce what a Pipeline is fed with
+template <typename Function>
+struct ArgumentOf : ArgumentOf<decltype(&Function::operator())> { };
+
+template <typename R, typename A>
+struct ArgumentOf<R (*)(A)> {
+    using type = std::decay_t<A>;
+};
+
+template <typename R, typename C, typename A>
+struct ArgumentOf<R (C::*)(A)> : ArgumentOf<R (*)(A)> { };
+
+template <typename R, typename C, typename A>
+struct ArgumentOf<R (C::*)(A) const> : ArgumentOf<R (*)(A)> { };
+
+template <typename R, typename A>
+struct ArgumentOf<R (*)(A) noexcept> : ArgumentOf<R (*)(A)> { };
+
+template <typename R, typename C, typename A>
+struct ArgumentOf<R (C::*)(A) noexcept> : ArgumentOf<R (*)(A)> { };
+
+template <typename R, typename C, typename A>
+struct ArgumentOf<R (C::*)(A) const noexcept> : ArgumentOf<R (*)(A)> { };
+
+// Fused stages at the front of Stages
+template <typename... Stages>
+constexpr std::size_t kFusedPrefix = 0;
+
+template <typename Stage, typename... Stages>
+constexpr std::size_t kFusedPrefix<Stage, Stages...> = Stage::kFused ? 1 + kFusedPrefix<Stages...> : 0;
+
+// Stages a segment runs, its unfused first one and the fused ones right after it
+template <typename Stages>
+constexpr std::size_t kSegmentSize = 0;
+
+template <typename Head, typename... Stages>
+constexpr std::size_t kSegmentSize<std::tuple<Head, Stages...>> = 1 + kFusedPrefix<Stages...>;
+
+// Count elements of a tuple starting at Begin
+template <std::size_t Begin, std::size_t Count, typename Tuple, typename = std::make_index_sequence<Count>>
+struct Slice;
+
+template <std::size_t Begin, std::size_t Count, typename... Ts, std::size_t... I>
+struct Slice<Begin, Count, std::tuple<Ts...>, std::index_sequence<I...>> {
+    using type = std::tuple<std::tuple_element_t<Begin + I, std::tuple<Ts...>>...>;
+
+    static type From(std::tuple<Ts...>& tuple)
+    {
+        return type { std::get<Begin + I>(std::move(tuple))... };
+    }
+};
+
+// What comes out of Stages when In goes in, void once a stage returns nothing
+template <typename In, typename Stages>
+struct Through {
+    using type = In;
+};
+
+template <typename In, typename Stage, typename... Stages>
+struct Through<In, std::tuple<Stage, Stages...>> : Through<ResultOf<decltype(Stage::function), In>, std::tuple<Stages...>> { };
+
+// Past the last segment
+struct PipelineEnd {
+    void Stop() noexcept { }
+    void WaitIdle() noexcept { }
+};
+
+// An unfused stage and the fused ones following it, run by a Tasker of their own that hands the result to Next
+//
+// Items wait in ring slots allocated up front, a SpscQueue when a single worker feeds a single one.
+// Payloads only ever move, from Post() into the slot, out of it to the stages and into the next slot.
+template <typename In, std::size_t Producers, typename Stages>
+class PipelineSegment {
+    using Head = std::tuple_element_t<0, Stages>;
+
+    static_assert(!Head::kFused, "The first stage has to have workers of its own");
+
+    static constexpr std::size_t kSize = kSegmentSize<Stages>;
+    static constexpr std::size_t kRest = std::tuple_size_v<Stages> - kSize;
+
+    using Mine = Slice<0, kSize, Stages>;
+    using Others = Slice<kSize, kRest, Stages>;
+    using Out = typename Through<In, typename Mine::type>::type;
+    using Next = std::conditional_t<kRest == 0, PipelineEnd, PipelineSegment<Out, Head::kWorkers, typename Others::type>>;
+
+    static_assert(kRest == 0 || !std::is_void_v<Out>, "Only the last stage may return void");
+    static_assert(kRest != 0 || std::is_void_v<Out>, "The last stage has to return void");
+
+    using Queue = std::conditional_t<!std::is_nothrow_move_constructible_v<In>, ConcurrentQueue<In>,
+        std::conditional_t<Producers == 1 && Head::kWorkers == 1, SpscQueue<In>, RingQueue<In>>>;
+
+public:
+    explicit PipelineSegment(Stages& stages)
+        : next_ { MakeNext(stages) }
+        , stages_ { Mine::From(stages) }
+        , tasker_ { [this](In&& value) { Forward<0>(std::move(value)); }, Options() }
+    {
+    }
+
+    template <typename... Args>
+    bool Post(Args&&... args)
+    {
+        return tasker_.Post(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool TryPost(Args&&... args)
+    {
+        return tasker_.TryPost(std::forward<Args>(args)...);
+    }
+
+    // Drains this segment into the next one before stopping that one
+    void Stop()
+    {
+        tasker_.Stop();
+        next_.Stop();
+    }
+
+    void WaitIdle()
+    {
+        tasker_.WaitIdle();
+        next_.WaitIdle();
+    }
+
+private:
+    static Next MakeNext(Stages& stages)
+    {
+        if constexpr (kRest == 0) {
+            return Next {};
+        } else {
+            auto others = Others::From(stages);
+
+            return Next { others };
+        }
+    }
+
+    TaskerOptions Options() const
+    {
+        TaskerOptions options {};
+
+        options.bound.capacity = std::get<0>(stages_).capacity;
+
+        return options;
+    }
+
+    // Runs stage I on value, then the fused ones after it, and posts the outcome to the next segment
+    template <std::size_t I, typename V>
+    void Forward(V&& value)
+    {
+        if constexpr (I == kSize) {
+            next_.Post(std::forward<V>(value));
+        } else {
+            auto& function = std::get<I>(stages_).function;
+
+            if constexpr (std::is_void_v<ResultOf<decltype(function), V>>)
+                std::invoke(function, std::forward<V>(value));
+            else
+                Forward<I + 1>(std::invoke(function, std::forward<V>(value)));
+        }
+    }
+
+    // Declared first so that it outlives the workers posting to it
+    Next next_;
+    typename Mine::type stages_;
+    Tasker<In, Head::kWorkers, Queue> tasker_;
+};
+
+} // namespace detail
+
+// Stage run by N workers of its own, capacity bounding the items waiting for it
+template <std::size_t N = 1, typename Function>
+auto Stage(Function function, std::size_t capacity = 0)
+{
+    return detail::PipelineStage<N, false, Function> { std::move(function), capacity };
+}
+
+// Stage run right after the one before it on the same worker, for cheap steps not worth a hand-off
+template <typename Function>
+auto Fuse(Function function)
+{
+    return detail::PipelineStage<1, true, Function> { std::move(function), 0 };
+}
+
+// Chain of stages, each one feeding what it returns to the next one, the last one returning void
+//
+// What goes in is deduced from the first stage, which has to take a single concrete argument.
+// Stopping drains the stages in order, so everything posted before goes through the whole pipeline.
+template <typename In, typename... Stages>
+class Pipeline {
+public:
+    explicit Pipeline(Stages... stages)
+        : Pipeline { std::tuple<Stages...> { std::move(stages)... } }
+    {
+    }
+
+    ~Pipeline()
+    {
+        Stop();
+    }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    Pipeline(Pipeline&&) = delete;
+    Pipeline& operator=(Pipeline&&) = delete;
+
+    template <typename... Args>
+    bool Post(Args&&... args)
+    {
+        return first_.Post(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool TryPost(Args&&... args)
+    {
+        return first_.TryPost(std::forward<Args>(args)...);
+    }
+
+    void Stop()
+    {
+        first_.Stop();
+    }
+
+    // Returns once every item posted so far went through the last stage
+    void WaitIdle()
+    {
+        first_.WaitIdle();
+    }
+
+private:
+    explicit Pipeline(std::tuple<Stages...>&& stages)
+        : first_ { stages }
+    {
+    }
+
+    detail::PipelineSegment<In, 0, std::tuple<Stages...>> first_;
+};
+
+template <typename First, typename... Stages>
+Pipeline(First, Stages...) -> Pipeline<typename detail::ArgumentOf<decltype(First::function)>::type, First, Stages...>;
+
+#endif // PIPELINE_H_
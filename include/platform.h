@@ -0,0 +1,205 @@
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/membarrier.h>)
+#include <linux/membarrier.h>
+#define TASKER_HAS_MEMBARRIER
+#endif
+#endif
+
+// Define TASKER_USE_NUMA and link with libnuma for node-local allocation and pinning to nodes
+#if defined(TASKER_USE_NUMA)
+#include <numa.h>
+#endif
+
+#if defined(__cpp_lib_hardware_interference_size) && !defined(__GNUC__)
+inline constexpr std::size_t kCacheLineSize = std::hardware_destructive_interference_size;
+#else
+// GCC's constant follows -mtune and warns when it ends up in a class layout, so stick to the common 64 bytes
+inline constexpr std::size_t kCacheLineSize = 64;
+#endif
+
+// Where workers run
+//
+// Worker n is pinned to cpus[n % cpus.size()] or, with TASKER_USE_NUMA, to nodes[n % nodes.size()].
+// Empty lists leave scheduling to the OS. The state a worker owns is allocated on the node it's pinned to.
+struct Affinity {
+    std::vector<int> cpus {};
+    std::vector<int> nodes {};
+};
+
+namespace detail {
+
+// NUMA node of worker n, -1 if it's unknown
+inline int NodeOf(const Affinity& affinity, std::size_t n)
+{
+#if defined(TASKER_USE_NUMA)
+    if (numa_available() < 0)
+        return -1;
+    else if (!affinity.nodes.empty())
+        return affinity.nodes[n % affinity.nodes.size()];
+    else if (!affinity.cpus.empty())
+        return numa_node_of_cpu(affinity.cpus[n % affinity.cpus.size()]);
+#else
+    (void)affinity;
+    (void)n;
+#endif
+
+    return -1;
+}
+
+// Pins the calling thread as worker n, best effort
+inline void Pin(const Affinity& affinity, std::size_t n)
+{
+#if defined(TASKER_USE_NUMA)
+    if (affinity.cpus.empty() && !affinity.nodes.empty() && numa_available() >= 0) {
+        numa_run_on_node(affinity.nodes[n % affinity.nodes.size()]);
+        return;
+    }
+#endif
+
+#if defined(__linux__)
+    if (!affinity.cpus.empty()) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(affinity.cpus[n % affinity.cpus.size()], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#else
+    (void)affinity;
+    (void)n;
+#endif
+}
+
+// CPUs the main thread was allowed on when this was made, to undo Pin() before a thread runs something else
+//
+// Not the calling thread's, which may be a pinned worker whose mask every thread it starts inherits.
+class SavedAffinity {
+public:
+    SavedAffinity() noexcept
+    {
+#if defined(__linux__)
+        saved_ = sched_getaffinity(getpid(), sizeof(set_), &set_) == 0;
+#endif
+    }
+
+    // Sets it on the calling thread
+    void Restore() const noexcept
+    {
+#if defined(__linux__)
+        if (saved_)
+            pthread_setaffinity_np(pthread_self(), sizeof(set_), &set_);
+#endif
+    }
+
+private:
+#if defined(__linux__)
+    cpu_set_t set_ {};
+    bool saved_ { false };
+#endif
+};
+
+// Whether HeavyFence() can serialize the other threads, registering the process the first time
+inline bool AsymmetricFences() noexcept
+{
+#if defined(TASKER_HAS_MEMBARRIER)
+    static const bool available = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+
+    return available;
+#else
+    return false;
+#endif
+}
+
+// Fences for a Dekker-style handshake between a hot side and a rare one, say a producer and a parking consumer
+//
+// The heavy one runs membarrier(), which acts as a full fence on every running thread of the process,
+// so the light one only has to keep the compiler from reordering. Without it both are seq_cst fences.
+inline void LightFence() noexcept
+{
+    if (AsymmetricFences())
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    else
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline void HeavyFence() noexcept
+{
+#if defined(TASKER_HAS_MEMBARRIER)
+    if (AsymmetricFences() && syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0)
+        return;
+#endif
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template <typename T>
+struct NodeDeleter {
+    int node { -1 };
+
+    void operator()(T* object) const noexcept
+    {
+        object->~T();
+
+#if defined(TASKER_USE_NUMA)
+        if (node >= 0) {
+            numa_free(object, sizeof(T));
+            return;
+        }
+#endif
+
+        ::operator delete(object, std::align_val_t { alignof(T) });
+    }
+};
+
+template <typename T>
+using NodePtr = std::unique_ptr<T, NodeDeleter<T>>;
+
+// Allocates T on the given NUMA node, or anywhere with the alignment of T when node is -1
+template <typename T, typename... Args>
+NodePtr<T> MakeOnNode(int node, Args&&... args)
+{
+    void* storage = nullptr;
+
+#if defined(TASKER_USE_NUMA)
+    if (node >= 0)
+        storage = numa_alloc_onnode(sizeof(T), node);
+#endif
+
+    if (!storage) {
+        node = -1;
+        storage = ::operator new(sizeof(T), std::align_val_t { alignof(T) });
+    }
+
+    try {
+        // numa_alloc_onnode() returns whole pages, so alignof(T) is satisfied anyway
+        return NodePtr<T> { ::new (storage) T(std::forward<Args>(args)...), NodeDeleter<T> { node } };
+    } catch (...) {
+#if defined(TASKER_USE_NUMA)
+        if (node >= 0)
+            numa_free(storage, sizeof(T));
+        else
+#endif
+            ::operator delete(storage, std::align_val_t { alignof(T) });
+
+        throw;
+    }
+}
+
+} // namespace detail
+
+#endif // PLATFORM_H_
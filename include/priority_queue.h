@@ -0,0 +1,521 @@
+#ifndef PRIORITY_QUEUE_H_
+#define PRIORITY_QUEUE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bound.h"
+
+// Lane of an item, 0 being the most urgent
+struct Priority {
+    std::size_t level;
+};
+
+// MPMC queue with Levels FIFO lanes, unbounded unless given a Bound
+//
+// Pop takes from the most urgent non-empty lane, except that a lane passed over Quantum times in a row
+// gets the next turn, which bounds how long a flood of urgent items can starve the others.
+// Every operation is O(Levels) under one mutex, with Levels small enough for that to be a few compares.
+// Items pushed without a Priority go to the least urgent lane, which is also where DropOldest evicts from.
+template <typename T, std::size_t Levels, std::size_t Quantum = 8>
+class PriorityQueue {
+public:
+    using value_type = T;
+
+    template <typename U>
+    using rebind = PriorityQueue<U, Levels, Quantum>;
+
+    static constexpr std::size_t kLevels = Levels;
+
+    static_assert(Levels != 0 && Quantum != 0);
+
+    PriorityQueue() = default;
+
+    explicit PriorityQueue(Bound bound) noexcept
+        : bound_ { bound }
+    {
+    }
+
+    ~PriorityQueue() = default;
+    PriorityQueue(const PriorityQueue&) = delete;
+    PriorityQueue& operator=(const PriorityQueue&) = delete;
+
+    PriorityQueue(PriorityQueue&& other) noexcept(std::is_nothrow_move_constructible_v<std::queue<T>>)
+    {
+        std::lock_guard lock { other.mutex_ };
+
+        bound_ = other.bound_;
+        lanes_ = std::move(other.lanes_);
+        UpdateSize();
+        other.UpdateSize();
+    }
+
+    PriorityQueue& operator=(PriorityQueue&& other) noexcept(std::is_nothrow_move_assignable_v<std::queue<T>>)
+    {
+        assert(this != &other);
+
+        {
+            std::scoped_lock lock { mutex_, other.mutex_ };
+
+            bound_ = other.bound_;
+            lanes_ = std::move(other.lanes_);
+            skipped_ = {};
+            UpdateSize();
+            other.UpdateSize();
+        }
+
+        // A consumer parked on the old items has to see the new ones
+        cv_.notify_all();
+        producer_cv_.notify_all();
+
+        return *this;
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    std::size_t Size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    std::size_t Capacity() const noexcept
+    {
+        return bound_.capacity;
+    }
+
+    // Items evicted to make room so far, which never get popped
+    std::size_t Dropped() const noexcept
+    {
+        return dropped_.load(std::memory_order_acquire);
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard lock { mutex_ };
+
+            done_ = true;
+        }
+
+        cv_.notify_all();
+        producer_cv_.notify_all();
+    }
+
+    // Returns how many items were dropped
+    std::size_t Clear()
+    {
+        std::array<std::queue<T>, Levels> lanes;
+        std::size_t count = 0;
+
+        {
+            std::lock_guard lock { mutex_ };
+
+            lanes_.swap(lanes);
+            skipped_ = {};
+            UpdateSize();
+        }
+
+        producer_cv_.notify_all();
+
+        for (const auto& lane : lanes)
+            count += lane.size();
+
+        return count;
+    }
+
+    bool Push(const T& value)
+    {
+        return Emplace(value);
+    }
+
+    bool Push(T&& value)
+    {
+        return Emplace(std::move(value));
+    }
+
+    bool Push(Priority priority, const T& value)
+    {
+        return Emplace(priority, value);
+    }
+
+    bool Push(Priority priority, T&& value)
+    {
+        return Emplace(priority, std::move(value));
+    }
+
+    template <typename... Args>
+    bool Emplace(Args&&... args)
+    {
+        return Emplace(Priority { Levels - 1 }, std::forward<Args>(args)...);
+    }
+
+    // Fails once the queue is stopped, or when it's full and rejects
+    template <typename... Args>
+    bool Emplace(Priority priority, Args&&... args)
+    {
+        std::unique_lock lock { mutex_ };
+
+        return EmplaceLocked(lock, true, true, priority, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    bool Offer(Args&&... args)
+    {
+        return Offer(Priority { Levels - 1 }, std::forward<Args>(args)...);
+    }
+
+    // Like Emplace but fails instead of blocking when the queue is full
+    template <typename... Args>
+    bool Offer(Priority priority, Args&&... args)
+    {
+        std::unique_lock lock { mutex_ };
+
+        return EmplaceLocked(lock, false, true, priority, std::forward<Args>(args)...);
+    }
+
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PushBulk(InputIt first, Sentinel last)
+    {
+        return PushBulk(Priority { Levels - 1 }, std::move(first), std::move(last));
+    }
+
+    // Pushes [first, last) into one lane under a single lock with a single wake-up, unless it has to wait for room
+    //
+    // Returns how many items went in, the rest being rejected.
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PushBulk(Priority priority, InputIt first, Sentinel last)
+    {
+        std::size_t count = 0;
+        std::size_t sleepers = 0;
+        std::vector<T> evicted;
+
+        {
+            std::unique_lock lock { mutex_ };
+
+            auto& lane = Lane(priority);
+
+            for (; first != last && Reserve(lock, true, true); ++first, ++count) {
+                if (Full()) {
+                    evicted.push_back(Evict());
+                    dropped_.fetch_add(1, std::memory_order_release);
+                }
+
+                lane.emplace(*first);
+                UpdateSize();
+            }
+
+            sleepers = sleepers_;
+        }
+
+        if (sleepers == 0 || count == 0)
+            return count;
+        else if (sleepers == 1 || count == 1)
+            cv_.notify_one();
+        else
+            cv_.notify_all();
+
+        return count;
+    }
+
+    template <std::ranges::input_range Range>
+    std::size_t PushRange(Range&& range)
+    {
+        return PushBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    std::optional<T> Pop()
+    {
+        std::optional<T> value;
+
+        PopWith([&](T&& item) { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    bool Pop(T& out)
+    {
+        return PopWith([&](T&& item) { out = std::move(item); });
+    }
+
+    // Calls function(T&&) on the next item in place under the lock and pops it, as ConcurrentQueue::PopWith does
+    template <typename Function>
+    bool PopWith(Function&& function)
+    {
+        std::unique_lock lock { mutex_ };
+        Sleep(lock);
+
+        return PopLocked(lock, function);
+    }
+
+    template <typename OutputIt>
+    std::size_t PopBulk(OutputIt out, std::size_t max)
+    {
+        std::unique_lock lock { mutex_ };
+        Sleep(lock);
+
+        return PopLocked(lock, out, max);
+    }
+
+    bool TryPush(const T& value)
+    {
+        return TryEmplace(value);
+    }
+
+    bool TryPush(T&& value)
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    template <typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        return TryEmplace(Priority { Levels - 1 }, std::forward<Args>(args)...);
+    }
+
+    // Fails when the lock is taken or the queue is full, whatever the overflow, and never evicts
+    template <typename... Args>
+    bool TryEmplace(Priority priority, Args&&... args)
+    {
+        std::unique_lock lock { mutex_, std::try_to_lock };
+
+        if (!lock)
+            return false;
+
+        return EmplaceLocked(lock, false, false, priority, std::forward<Args>(args)...);
+    }
+
+    std::optional<T> TryPop()
+    {
+        std::optional<T> value;
+
+        TryPopWith([&](T&& item) { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    bool TryPop(T& out)
+    {
+        return TryPopWith([&](T&& item) { out = std::move(item); });
+    }
+
+    template <typename Function>
+    bool TryPopWith(Function&& function)
+    {
+        if (std::unique_lock lock { mutex_, std::try_to_lock }; lock)
+            return PopLocked(lock, function);
+
+        return false;
+    }
+
+    template <typename OutputIt>
+    std::size_t TryPopBulk(OutputIt out, std::size_t max)
+    {
+        if (std::unique_lock lock { mutex_, std::try_to_lock }; lock)
+            return PopLocked(lock, out, max);
+
+        return 0;
+    }
+
+private:
+    std::queue<T>& Lane(Priority priority)
+    {
+        assert(priority.level < Levels);
+
+        return lanes_[std::min(priority.level, Levels - 1)];
+    }
+
+    bool Full() const
+    {
+        return bound_.capacity != 0 && size_.load(std::memory_order_relaxed) >= bound_.capacity;
+    }
+
+    // Waits for room if the bound says so, false if the item is rejected or the queue is stopped
+    //
+    // A full DropOldest queue passes when evict is set, leaving the eviction to the caller.
+    bool Reserve(std::unique_lock<std::mutex>& lock, bool wait, bool evict)
+    {
+        if (Full() && !(evict && bound_.overflow == Overflow::DropOldest)) {
+            if (!wait || bound_.overflow != Overflow::Block)
+                return false;
+
+            while (!done_ && Full()) {
+                // Consumers might sleep through a bulk push that stopped halfway
+                if (sleepers_ != 0)
+                    cv_.notify_all();
+
+                ++producers_;
+                producer_cv_.wait(lock);
+                --producers_;
+            }
+        }
+
+        return !done_;
+    }
+
+    // Oldest item of the least urgent non-empty lane, the queue must not be empty
+    T Evict()
+    {
+        auto level = Levels - 1;
+
+        while (lanes_[level].empty())
+            --level;
+
+        T value(std::move(lanes_[level].front()));
+        lanes_[level].pop();
+        UpdateSize();
+
+        return value;
+    }
+
+    // The evicted item is destroyed outside of the lock, in case that's where it queues more work
+    template <typename... Args>
+    bool EmplaceLocked(std::unique_lock<std::mutex>& lock, bool wait, bool evict, Priority priority, Args&&... args)
+    {
+        std::optional<T> evicted;
+
+        if (!Reserve(lock, wait, evict))
+            return false;
+
+        if (Full()) {
+            evicted.emplace(Evict());
+            dropped_.fetch_add(1, std::memory_order_release);
+        }
+
+        Lane(priority).emplace(std::forward<Args>(args)...);
+        UpdateSize();
+
+        const auto notify = sleepers_ != 0;
+
+        lock.unlock();
+
+        if (notify)
+            cv_.notify_one();
+
+        return true;
+    }
+
+    template <typename Lock>
+    void Sleep(Lock& lock)
+    {
+        while (!done_ && size_.load(std::memory_order_relaxed) == 0) {
+            ++sleepers_;
+            cv_.wait(lock);
+            --sleepers_;
+        }
+    }
+
+    // Picks the lane to serve and ages the ones it passes over, the queue must not be empty
+    std::queue<T>& Next()
+    {
+        auto chosen = Levels;
+
+        for (std::size_t level = 1; level < Levels && chosen == Levels; ++level) {
+            if (!lanes_[level].empty() && skipped_[level] >= Quantum)
+                chosen = level;
+        }
+
+        for (std::size_t level = 0; level < Levels && chosen == Levels; ++level) {
+            if (!lanes_[level].empty())
+                chosen = level;
+        }
+
+        for (std::size_t level = chosen + 1; level < Levels; ++level) {
+            if (!lanes_[level].empty())
+                ++skipped_[level];
+        }
+
+        skipped_[chosen] = 0;
+
+        return lanes_[chosen];
+    }
+
+    template <typename Function>
+    bool PopLocked(std::unique_lock<std::mutex>& lock, Function& function)
+    {
+        if (size_.load(std::memory_order_relaxed) == 0)
+            return false;
+
+        auto& lane = Next();
+
+        std::invoke(function, std::move(lane.front()));
+        lane.pop();
+        UpdateSize();
+
+        const auto notify = producers_ != 0;
+
+        lock.unlock();
+
+        if (notify)
+            producer_cv_.notify_one();
+
+        return true;
+    }
+
+    template <typename OutputIt>
+    std::size_t PopLocked(std::unique_lock<std::mutex>& lock, OutputIt& out, std::size_t max)
+    {
+        std::size_t count = 0;
+
+        for (auto size = size_.load(std::memory_order_relaxed); count < max && count < size; ++count) {
+            auto& lane = Next();
+
+            *out++ = std::move(lane.front());
+            lane.pop();
+        }
+
+        UpdateSize();
+
+        const auto producers = producers_;
+
+        lock.unlock();
+
+        if (producers == 0 || count == 0)
+            return count;
+        else if (producers == 1 || count == 1)
+            producer_cv_.notify_one();
+        else
+            producer_cv_.notify_all();
+
+        return count;
+    }
+
+    void UpdateSize()
+    {
+        std::size_t size = 0;
+
+        for (const auto& lane : lanes_)
+            size += lane.size();
+
+        size_.store(size, std::memory_order_relaxed);
+    }
+
+    Bound bound_ {};
+    bool done_ { false };
+    std::size_t sleepers_ { 0 };
+    std::size_t producers_ { 0 };
+    std::atomic_size_t size_ { 0 };
+    std::atomic_size_t dropped_ { 0 };
+    std::array<std::queue<T>, Levels> lanes_;
+    std::array<std::size_t, Levels> skipped_ {};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable producer_cv_;
+};
+
+#endif // PRIORITY_QUEUE_H_
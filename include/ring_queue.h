@@ -0,0 +1,449 @@
+#ifndef RING_QUEUE_H_
+#define RING_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#include "bound.h"
+#include "platform.h"
+
+// Bounded lock-free MPMC queue (Dmitry Vyukov's sequence-numbered ring buffer)
+//
+// Capacity is fixed at compile time (StaticCapacity != 0) or at construction time (StaticCapacity == 0),
+// rounded up to a power of two. Slots are allocated once, so the hot path never allocates.
+// A Bound picks the capacity when there is no StaticCapacity, and what Emplace does once the ring is full.
+template <typename T, std::size_t StaticCapacity = 0>
+class RingQueue {
+public:
+    using value_type = T;
+
+    template <typename U>
+    using rebind = RingQueue<U, StaticCapacity>;
+
+    static constexpr std::size_t kDefaultCapacity = 1024;
+
+    static_assert(StaticCapacity == 0 || std::has_single_bit(StaticCapacity), "Capacity must be a power of two");
+    static_assert(std::is_nothrow_move_constructible_v<T>);
+
+    RingQueue()
+        : RingQueue { StaticCapacity != 0 ? StaticCapacity : kDefaultCapacity, 0 }
+    {
+    }
+
+    explicit RingQueue(std::size_t capacity) requires(StaticCapacity == 0)
+        : RingQueue { capacity, 0 }
+    {
+    }
+
+    explicit RingQueue(Bound bound)
+        : RingQueue { StaticCapacity != 0 ? StaticCapacity : (bound.capacity != 0 ? bound.capacity : kDefaultCapacity), 0 }
+    {
+        overflow_ = bound.overflow;
+    }
+
+    ~RingQueue()
+    {
+        Clear();
+    }
+
+    RingQueue(const RingQueue&) = delete;
+    RingQueue& operator=(const RingQueue&) = delete;
+
+    // Items are transferred one by one, so other's producers and consumers may keep running
+    RingQueue(RingQueue&& other)
+        : RingQueue { other.mask_ + 1, 0 }
+    {
+        overflow_ = other.overflow_;
+
+        while (auto value = other.TryPop())
+            Emplace(*std::move(value));
+    }
+
+    RingQueue& operator=(RingQueue&& other) noexcept
+    {
+        assert(this != &other);
+        assert(mask_ >= other.mask_);
+
+        Clear();
+
+        while (auto value = other.TryPop())
+            Emplace(*std::move(value));
+
+        return *this;
+    }
+
+    std::size_t Capacity() const noexcept
+    {
+        return mask_ + 1;
+    }
+
+    // Items evicted to make room so far, which never get popped
+    std::size_t Dropped() const noexcept
+    {
+        return dropped_.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    // Approximate while producers or consumers are running
+    std::size_t Size() const
+    {
+        const auto head = dequeue_pos_.load(std::memory_order_relaxed);
+        const auto tail = enqueue_pos_.load(std::memory_order_relaxed);
+
+        return tail > head ? std::min(tail - head, mask_ + 1) : 0;
+    }
+
+    void Stop()
+    {
+        done_.store(true, std::memory_order_seq_cst);
+
+        Wake(consumer_signal_, true);
+        Wake(producer_signal_, true);
+    }
+
+    // Returns how many items were dropped
+    std::size_t Clear()
+    {
+        std::size_t count = 0;
+
+        while (TryPop())
+            ++count;
+
+        return count;
+    }
+
+    bool Push(const T& value)
+    {
+        return Emplace(value);
+    }
+
+    bool Push(T&& value)
+    {
+        return Emplace(std::move(value));
+    }
+
+    // Blocks while the queue is full, fails once it's stopped or when it's full and rejects
+    template <typename... Args>
+    bool Emplace(Args&&... args)
+    {
+        if (overflow_ != Overflow::Block)
+            return Offer(std::forward<Args>(args)...);
+
+        auto pushed = false;
+
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            Wait(producers_, producer_signal_, [&] { return pushed = TryEmplace(std::forward<Args>(args)...); });
+        } else {
+            T value(std::forward<Args>(args)...);
+
+            Wait(producers_, producer_signal_, [&] { return pushed = TryEmplace(std::move(value)); });
+        }
+
+        return pushed;
+    }
+
+    // Like Emplace but fails instead of blocking when the queue is full
+    template <typename... Args>
+    bool Offer(Args&&... args)
+    {
+        if (overflow_ != Overflow::DropOldest)
+            return TryEmplace(std::forward<Args>(args)...);
+
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            while (!Enqueue(std::forward<Args>(args)...)) {
+                if (done_.load(std::memory_order_relaxed))
+                    return false;
+
+                if (TryPop())
+                    dropped_.fetch_add(1, std::memory_order_release);
+            }
+
+            Notify(consumers_, consumer_signal_);
+
+            return true;
+        } else {
+            T value(std::forward<Args>(args)...);
+
+            return Offer(std::move(value));
+        }
+    }
+
+    // Wakes consumers once for the whole batch unless the queue fills up in between
+    //
+    // Returns how many items went in, the rest being rejected.
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PushBulk(InputIt first, Sentinel last)
+    {
+        std::size_t count = 0;
+
+        for (; first != last; ++first) {
+            if (Enqueue(*first)) {
+                ++count;
+                continue;
+            }
+
+            Notify(consumers_, consumer_signal_);
+
+            if (Emplace(*first))
+                ++count;
+            else if (done_.load(std::memory_order_relaxed))
+                break;
+        }
+
+        Notify(consumers_, consumer_signal_);
+
+        return count;
+    }
+
+    template <std::ranges::input_range Range>
+    std::size_t PushRange(Range&& range)
+    {
+        return PushBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    // Blocks while the queue is empty, returns std::nullopt once stopped and drained
+    std::optional<T> Pop()
+    {
+        std::optional<T> value;
+
+        PopWith([&](T&& item) noexcept { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    // Moves the oldest item straight into out, false once stopped and drained
+    bool Pop(T& out)
+    {
+        return PopWith([&](T&& item) noexcept { out = std::move(item); });
+    }
+
+    // Blocks while the queue is empty, then calls function(T&&) on the oldest item in its slot and destroys it
+    template <typename Function>
+    bool PopWith(Function&& function)
+    {
+        auto popped = false;
+
+        Wait(consumers_, consumer_signal_, [&] { return popped = TryPopWith(function); });
+
+        return popped;
+    }
+
+    // Blocks until there is at least one item, then moves up to max items into out
+    template <typename OutputIt>
+    std::size_t PopBulk(OutputIt out, std::size_t max)
+    {
+        std::size_t count = 0;
+
+        Wait(consumers_, consumer_signal_, [&] { return (count = TryPopBulk(out, max)) != 0; });
+
+        return count;
+    }
+
+    bool TryPush(const T& value)
+    {
+        return TryEmplace(value);
+    }
+
+    bool TryPush(T&& value)
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    // Fails if the queue is full or stopped, whatever the overflow
+    template <typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        if (!Enqueue(std::forward<Args>(args)...))
+            return false;
+
+        Notify(consumers_, consumer_signal_);
+
+        return true;
+    }
+
+    std::optional<T> TryPop()
+    {
+        std::optional<T> value;
+
+        TryPopWith([&](T&& item) noexcept { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    bool TryPop(T& out)
+    {
+        return TryPopWith([&](T&& item) noexcept { out = std::move(item); });
+    }
+
+    // The slot is claimed before function runs and can't be handed back, so function must not throw
+    template <typename Function>
+    bool TryPopWith(Function&& function)
+    {
+        static_assert(std::is_nothrow_invocable_v<Function&, T&&>);
+
+        auto* slot = Claim(dequeue_pos_, 1);
+
+        if (!slot)
+            return false;
+
+        auto* item = std::launder(reinterpret_cast<T*>(slot->storage));
+
+        std::invoke(function, std::move(*item));
+        item->~T();
+        Publish(slot, mask_);
+
+        Notify(producers_, producer_signal_);
+
+        return true;
+    }
+
+    // Moves every item from its slot to out directly
+    template <typename OutputIt>
+    std::size_t TryPopBulk(OutputIt out, std::size_t max)
+    {
+        std::size_t count = 0;
+
+        while (count < max && TryPopWith([&](T&& item) noexcept { *out++ = std::move(item); }))
+            ++count;
+
+        return count;
+    }
+
+private:
+    struct Slot {
+        std::atomic_size_t sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    RingQueue(std::size_t capacity, int)
+        : mask_ { std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1 }
+        , slots_ { std::make_unique<Slot[]>(mask_ + 1) }
+    {
+        for (std::size_t n = 0; n <= mask_; ++n)
+            slots_[n].sequence.store(n, std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    bool Enqueue(Args&&... args)
+    {
+        if (done_.load(std::memory_order_relaxed))
+            return false;
+
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            auto* slot = Claim(enqueue_pos_, 0);
+
+            if (!slot)
+                return false;
+
+            ::new (static_cast<void*>(slot->storage)) T(std::forward<Args>(args)...);
+            Publish(slot, 1);
+
+            return true;
+        } else {
+            // A throwing constructor must not leave a claimed slot behind, so construct first.
+            // The item is dropped if the ring filled up meanwhile, Emplace and Offer construct it themselves to keep it.
+            if (Size() > mask_)
+                return false;
+
+            T value(std::forward<Args>(args)...);
+
+            return Enqueue(std::move(value));
+        }
+    }
+
+    // Reserves the slot at position, whose sequence is position + offset when it's ready
+    Slot* Claim(std::atomic_size_t& position, std::size_t offset)
+    {
+        auto pos = position.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto& slot = slots_[pos & mask_];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence - (pos + offset));
+
+            if (diff == 0) {
+                if (position.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return &slot;
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Publish(Slot* slot, std::size_t offset)
+    {
+        slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + offset, std::memory_order_release);
+    }
+
+    // Parks until ready() succeeds or the queue is stopped, without touching a mutex
+    template <typename Ready>
+    void Wait(std::atomic_uint32_t& waiters, std::atomic_uint32_t& signal, Ready ready)
+    {
+        while (!ready()) {
+            waiters.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            const auto current = signal.load(std::memory_order_acquire);
+
+            if (ready() || done_.load(std::memory_order_seq_cst)) {
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+
+                break;
+            }
+
+            signal.wait(current, std::memory_order_acquire);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Skips the wake-up entirely when nobody is parked
+    void Notify(const std::atomic_uint32_t& waiters, std::atomic_uint32_t& signal)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waiters.load(std::memory_order_relaxed) != 0)
+            Wake(signal, false);
+    }
+
+    void Wake(std::atomic_uint32_t& signal, bool all)
+    {
+        signal.fetch_add(1, std::memory_order_release);
+
+        if (all)
+            signal.notify_all();
+        else
+            signal.notify_one();
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    Overflow overflow_ { Overflow::Block };
+    std::atomic_size_t dropped_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t enqueue_pos_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t dequeue_pos_ { 0 };
+    alignas(kCacheLineSize) std::atomic_bool done_ { false };
+    std::atomic_uint32_t consumers_ { 0 };
+    std::atomic_uint32_t producers_ { 0 };
+    std::atomic_uint32_t consumer_signal_ { 0 };
+    std::atomic_uint32_t producer_signal_ { 0 };
+};
+
+#endif // RING_QUEUE_H_
@@ -0,0 +1,455 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#include "bound.h"
+#include "platform.h"
+
+// Bounded wait-free queue for exactly one producer thread and one consumer thread
+//
+// Each side owns its index and keeps a cached copy of the other one, so it only reads the other side's cache line
+// when the ring looks full or empty. Where membarrier() is available, neither pushing nor popping runs a fence.
+// Capacity works as in RingQueue. DropOldest would need the producer to pop, so it rejects instead.
+// Clear() may come from any thread, the consumer drops the items on its next pop.
+template <typename T, std::size_t StaticCapacity = 0>
+class SpscQueue {
+public:
+    using value_type = T;
+
+    template <typename U>
+    using rebind = SpscQueue<U, StaticCapacity>;
+
+    static constexpr std::size_t kDefaultCapacity = 1024;
+    static constexpr bool kSingleProducer = true;
+
+    static_assert(StaticCapacity == 0 || std::has_single_bit(StaticCapacity), "Capacity must be a power of two");
+    static_assert(std::is_nothrow_move_constructible_v<T>);
+
+    SpscQueue()
+        : SpscQueue { StaticCapacity != 0 ? StaticCapacity : kDefaultCapacity, 0 }
+    {
+    }
+
+    explicit SpscQueue(std::size_t capacity) requires(StaticCapacity == 0)
+        : SpscQueue { capacity, 0 }
+    {
+    }
+
+    explicit SpscQueue(Bound bound)
+        : SpscQueue { StaticCapacity != 0 ? StaticCapacity : (bound.capacity != 0 ? bound.capacity : kDefaultCapacity), 0 }
+    {
+        block_ = bound.overflow == Overflow::Block;
+    }
+
+    ~SpscQueue()
+    {
+        for (auto head = head_.load(std::memory_order_relaxed); head != tail_.load(std::memory_order_relaxed); ++head)
+            Slot(head).~T();
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Items are transferred one by one, both sides of other must be quiet while this runs since it pops as a consumer
+    SpscQueue(SpscQueue&& other)
+        : SpscQueue { other.mask_ + 1, 0 }
+    {
+        block_ = other.block_;
+
+        while (auto value = other.TryPop())
+            Emplace(*std::move(value));
+    }
+
+    SpscQueue& operator=(SpscQueue&& other) noexcept
+    {
+        assert(this != &other);
+        assert(mask_ >= other.mask_);
+
+        Clear();
+
+        while (auto value = other.TryPop())
+            Emplace(*std::move(value));
+
+        return *this;
+    }
+
+    std::size_t Capacity() const noexcept
+    {
+        return mask_ + 1;
+    }
+
+    // Items a Clear() dropped so far, counted once the consumer destroyed them
+    std::size_t Dropped() const noexcept
+    {
+        return dropped_.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    // Exact from either side while the other one is quiet
+    std::size_t Size() const
+    {
+        const auto head = std::max(head_.load(std::memory_order_relaxed), drop_.load(std::memory_order_relaxed));
+        const auto tail = tail_.load(std::memory_order_relaxed);
+
+        return tail > head ? tail - head : 0;
+    }
+
+    void Stop()
+    {
+        done_.store(true, std::memory_order_seq_cst);
+
+        Wake(consumer_signal_, true);
+        Wake(producer_signal_, true);
+    }
+
+    // Marks everything posted so far as dropped, the consumer destroys it instead of returning it
+    //
+    // Returns 0 as the consumer may still pop some of it, what's dropped shows in Dropped() instead.
+    std::size_t Clear()
+    {
+        const auto tail = tail_.load(std::memory_order_acquire);
+        auto drop = drop_.load(std::memory_order_relaxed);
+
+        while (drop < tail && !drop_.compare_exchange_weak(drop, tail, std::memory_order_release, std::memory_order_relaxed))
+            ;
+
+        Notify(producers_, producer_signal_);
+
+        return 0;
+    }
+
+    bool Push(const T& value)
+    {
+        return Emplace(value);
+    }
+
+    bool Push(T&& value)
+    {
+        return Emplace(std::move(value));
+    }
+
+    // Blocks while the queue is full, fails once it's stopped or when it's full and rejects
+    template <typename... Args>
+    bool Emplace(Args&&... args)
+    {
+        if (!block_)
+            return TryEmplace(std::forward<Args>(args)...);
+
+        auto pushed = false;
+
+        if constexpr (std::is_nothrow_constructible_v<T, Args...>) {
+            Wait(producers_, producer_signal_, [&] { return pushed = TryEmplace(std::forward<Args>(args)...); });
+        } else {
+            T value(std::forward<Args>(args)...);
+
+            Wait(producers_, producer_signal_, [&] { return pushed = TryEmplace(std::move(value)); });
+        }
+
+        return pushed;
+    }
+
+    // Like Emplace but fails instead of blocking when the queue is full
+    template <typename... Args>
+    bool Offer(Args&&... args)
+    {
+        return TryEmplace(std::forward<Args>(args)...);
+    }
+
+    // Publishes and wakes the consumer once for the whole batch, unless the queue fills up in between
+    //
+    // Returns how many items went in, the rest being rejected.
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PushBulk(InputIt first, Sentinel last)
+    {
+        std::size_t count = 0;
+        auto tail = tail_.load(std::memory_order_relaxed);
+
+        for (; first != last && !done_.load(std::memory_order_relaxed); ++first) {
+            if (HasRoom(tail)) {
+                try {
+                    ::new (static_cast<void*>(&storage_[tail & mask_])) T(*first);
+                } catch (...) {
+                    // What went in so far stays in
+                    tail_.store(tail, std::memory_order_release);
+                    throw;
+                }
+
+                ++tail;
+                ++count;
+                continue;
+            }
+
+            tail_.store(tail, std::memory_order_release);
+            Notify(consumers_, consumer_signal_);
+
+            if (!Emplace(*first))
+                break;
+
+            ++count;
+            tail = tail_.load(std::memory_order_relaxed);
+        }
+
+        tail_.store(tail, std::memory_order_release);
+        Notify(consumers_, consumer_signal_);
+
+        return count;
+    }
+
+    template <std::ranges::input_range Range>
+    std::size_t PushRange(Range&& range)
+    {
+        return PushBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    // Blocks while the queue is empty, returns std::nullopt once stopped and drained
+    std::optional<T> Pop()
+    {
+        std::optional<T> value;
+
+        PopWith([&](T&& item) noexcept { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    // Moves the oldest item straight into out, false once stopped and drained
+    bool Pop(T& out)
+    {
+        return PopWith([&](T&& item) noexcept { out = std::move(item); });
+    }
+
+    // Blocks while the queue is empty, then calls function(T&&) on the oldest item in its slot and destroys it
+    template <typename Function>
+    bool PopWith(Function&& function)
+    {
+        auto popped = false;
+
+        Wait(consumers_, consumer_signal_, [&] { return popped = TryPopWith(function); });
+
+        return popped;
+    }
+
+    // Blocks until there is at least one item, then moves up to max items into out
+    template <typename OutputIt>
+    std::size_t PopBulk(OutputIt out, std::size_t max)
+    {
+        std::size_t count = 0;
+
+        Wait(consumers_, consumer_signal_, [&] { return (count = TryPopBulk(out, max)) != 0; });
+
+        return count;
+    }
+
+    bool TryPush(const T& value)
+    {
+        return TryEmplace(value);
+    }
+
+    bool TryPush(T&& value)
+    {
+        return TryEmplace(std::move(value));
+    }
+
+    // Fails if the queue is full or stopped, whatever the overflow
+    template <typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+
+        if (done_.load(std::memory_order_relaxed) || !HasRoom(tail))
+            return false;
+
+        ::new (static_cast<void*>(&storage_[tail & mask_])) T(std::forward<Args>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        Notify(consumers_, consumer_signal_);
+
+        return true;
+    }
+
+    std::optional<T> TryPop()
+    {
+        std::optional<T> value;
+
+        TryPopWith([&](T&& item) noexcept { value.emplace(std::move(item)); });
+
+        return value;
+    }
+
+    bool TryPop(T& out)
+    {
+        return TryPopWith([&](T&& item) noexcept { out = std::move(item); });
+    }
+
+    // The item is gone from the ring once function returns, so function must not throw
+    template <typename Function>
+    bool TryPopWith(Function&& function)
+    {
+        static_assert(std::is_nothrow_invocable_v<Function&, T&&>);
+
+        auto head = Skip();
+
+        if (!HasItem(head))
+            return false;
+
+        std::invoke(function, std::move(Slot(head)));
+        Slot(head).~T();
+        head_.store(head + 1, std::memory_order_release);
+        Notify(producers_, producer_signal_);
+
+        return true;
+    }
+
+    template <typename OutputIt>
+    std::size_t TryPopBulk(OutputIt out, std::size_t max)
+    {
+        std::size_t count = 0;
+        auto head = Skip();
+
+        for (; count < max && HasItem(head); ++count, ++head) {
+            *out++ = std::move(Slot(head));
+            Slot(head).~T();
+        }
+
+        if (count != 0) {
+            head_.store(head, std::memory_order_release);
+            Notify(producers_, producer_signal_);
+        }
+
+        return count;
+    }
+
+private:
+    struct alignas(T) Storage {
+        std::byte bytes[sizeof(T)];
+    };
+
+    SpscQueue(std::size_t capacity, int)
+        : mask_ { std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1 }
+        , storage_ { std::make_unique<Storage[]>(mask_ + 1) }
+    {
+    }
+
+    T& Slot(std::size_t position) noexcept
+    {
+        return *std::launder(reinterpret_cast<T*>(&storage_[position & mask_]));
+    }
+
+    // Producer side, rereads the consumer's index only when the cached one says the ring is full
+    bool HasRoom(std::size_t tail) noexcept
+    {
+        if (tail - cached_head_ <= mask_)
+            return true;
+
+        cached_head_ = head_.load(std::memory_order_acquire);
+
+        return tail - cached_head_ <= mask_;
+    }
+
+    // Consumer side, rereads the producer's index only when the cached one says the ring is empty
+    //
+    // Skip() may have moved the head past the cached tail, hence not comparing for equality.
+    bool HasItem(std::size_t head) noexcept
+    {
+        if (head < cached_tail_)
+            return true;
+
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+
+        return head < cached_tail_;
+    }
+
+    // Consumer side, destroys what Clear() dropped and returns the head past it
+    std::size_t Skip() noexcept
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        const auto drop = drop_.load(std::memory_order_acquire);
+
+        if (head >= drop)
+            return head;
+
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + (drop - head), std::memory_order_release);
+
+        for (; head < drop; ++head)
+            Slot(head).~T();
+
+        head_.store(head, std::memory_order_release);
+
+        return head;
+    }
+
+    // Parks until ready() succeeds or the queue is stopped, like RingQueue
+    //
+    // Parking takes the heavy fence, so that pushing and popping only need the light one.
+    template <typename Ready>
+    void Wait(std::atomic_uint32_t& waiters, std::atomic_uint32_t& signal, Ready ready)
+    {
+        while (!ready()) {
+            waiters.fetch_add(1, std::memory_order_relaxed);
+            detail::HeavyFence();
+
+            const auto current = signal.load(std::memory_order_acquire);
+
+            if (ready() || done_.load(std::memory_order_seq_cst)) {
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+
+                break;
+            }
+
+            signal.wait(current, std::memory_order_acquire);
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Pairs with the heavy fence in Wait()
+    void Notify(const std::atomic_uint32_t& waiters, std::atomic_uint32_t& signal)
+    {
+        detail::LightFence();
+
+        if (waiters.load(std::memory_order_relaxed) != 0)
+            Wake(signal, false);
+    }
+
+    void Wake(std::atomic_uint32_t& signal, bool all)
+    {
+        signal.fetch_add(1, std::memory_order_release);
+
+        if (all)
+            signal.notify_all();
+        else
+            signal.notify_one();
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Storage[]> storage_;
+    bool block_ { true };
+    alignas(kCacheLineSize) std::atomic_size_t tail_ { 0 };
+    std::size_t cached_head_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t head_ { 0 };
+    std::size_t cached_tail_ { 0 };
+    std::atomic_size_t dropped_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t drop_ { 0 };
+    std::atomic_bool done_ { false };
+    std::atomic_uint32_t consumers_ { 0 };
+    std::atomic_uint32_t producers_ { 0 };
+    std::atomic_uint32_t consumer_signal_ { 0 };
+    std::atomic_uint32_t producer_signal_ { 0 };
+};
+
+#endif // SPSC_QUEUE_H_
@@ -0,0 +1,189 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear latency histogram in nanoseconds, HDR style
+//
+// Values below 8 get a bucket each, then every power of two is split into 8 linear buckets,
+// which keeps the relative error under 12.5% over the whole 64-bit range.
+struct Histogram {
+    static constexpr std::size_t kSubBits = 3;
+    static constexpr std::size_t kSubBuckets = 1 << kSubBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    static constexpr std::size_t Index(std::uint64_t value) noexcept
+    {
+        if (value < kSubBuckets)
+            return static_cast<std::size_t>(value);
+
+        const auto shift = static_cast<std::size_t>(std::bit_width(value)) - 1 - kSubBits;
+
+        return (shift + 1) * kSubBuckets + static_cast<std::size_t>((value >> shift) & (kSubBuckets - 1));
+    }
+
+    // Smallest value that lands in bucket index
+    static constexpr std::uint64_t LowerBound(std::size_t index) noexcept
+    {
+        if (index < kSubBuckets)
+            return index;
+
+        const auto shift = index / kSubBuckets - 1;
+
+        return (kSubBuckets + index % kSubBuckets) << shift;
+    }
+
+    std::uint64_t Count() const noexcept
+    {
+        std::uint64_t count = 0;
+
+        for (auto bucket : buckets)
+            count += bucket;
+
+        return count;
+    }
+
+    // Lower bound of the bucket holding the given quantile, in [0, 1]
+    std::uint64_t Quantile(double quantile) const noexcept
+    {
+        const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(Count()));
+        std::uint64_t seen = 0;
+
+        for (std::size_t index = 0; index < kBuckets; ++index) {
+            seen += buckets[index];
+
+            if (seen > rank)
+                return LowerBound(index);
+        }
+
+        return 0;
+    }
+
+    Histogram& operator+=(const Histogram& other) noexcept
+    {
+        for (std::size_t index = 0; index < kBuckets; ++index)
+            buckets[index] += other.buckets[index];
+
+        return *this;
+    }
+
+    std::array<std::uint64_t, kBuckets> buckets {};
+};
+
+// What Tasker::Snapshot() reports for one worker, all zero but depth unless built with TASKER_USE_STATS
+struct WorkerStats {
+    std::size_t depth { 0 }; // Queued items, including keyed and local ones
+    std::uint64_t posted { 0 }; // Items handed to this worker
+    std::uint64_t fallbacks { 0 }; // Posts that had to take the blocking path
+    std::uint64_t executed { 0 };
+    std::uint64_t steal_attempts { 0 };
+    std::uint64_t steals { 0 };
+    std::uint64_t parks { 0 }; // Times the worker went to sleep on its inbox
+    Histogram latency {}; // From posting to execution
+};
+
+namespace detail {
+
+#if defined(TASKER_USE_STATS)
+
+// Time an item was posted
+class Stamp {
+public:
+    std::uint64_t Elapsed() const noexcept
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - posted_).count());
+    }
+
+private:
+    std::chrono::steady_clock::time_point posted_ { std::chrono::steady_clock::now() };
+};
+
+// Counters of one worker, each written by a single thread or by relaxed increments that stay on its cache lines
+class Counters {
+public:
+    void Posted(std::uint64_t count = 1) noexcept
+    {
+        posted_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void Fallback() noexcept
+    {
+        fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Owner only from here on
+    void Executed(const Stamp& stamp) noexcept
+    {
+        Bump(executed_);
+        Bump(latency_[Histogram::Index(stamp.Elapsed())]);
+    }
+
+    void StealAttempt() noexcept
+    {
+        Bump(steal_attempts_);
+    }
+
+    void Stolen() noexcept
+    {
+        Bump(steals_);
+    }
+
+    void Parked() noexcept
+    {
+        Bump(parks_);
+    }
+
+    void Read(WorkerStats& stats) const noexcept
+    {
+        stats.posted = posted_.load(std::memory_order_relaxed);
+        stats.fallbacks = fallbacks_.load(std::memory_order_relaxed);
+        stats.executed = executed_.load(std::memory_order_relaxed);
+        stats.steal_attempts = steal_attempts_.load(std::memory_order_relaxed);
+        stats.steals = steals_.load(std::memory_order_relaxed);
+        stats.parks = parks_.load(std::memory_order_relaxed);
+
+        for (std::size_t index = 0; index < Histogram::kBuckets; ++index)
+            stats.latency.buckets[index] = latency_[index].load(std::memory_order_relaxed);
+    }
+
+private:
+    // The single writer doesn't need a locked read-modify-write
+    static void Bump(std::atomic_uint64_t& counter) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::atomic_uint64_t posted_ { 0 };
+    std::atomic_uint64_t fallbacks_ { 0 };
+    std::atomic_uint64_t executed_ { 0 };
+    std::atomic_uint64_t steal_attempts_ { 0 };
+    std::atomic_uint64_t steals_ { 0 };
+    std::atomic_uint64_t parks_ { 0 };
+    std::array<std::atomic_uint64_t, Histogram::kBuckets> latency_ {};
+};
+
+#else
+
+// Empty stand-ins that compile away
+struct Stamp { };
+
+struct Counters {
+    void Posted(std::uint64_t = 1) noexcept { }
+    void Fallback() noexcept { }
+    void Executed(const Stamp&) noexcept { }
+    void StealAttempt() noexcept { }
+    void Stolen() noexcept { }
+    void Parked() noexcept { }
+    void Read(WorkerStats&) const noexcept { }
+};
+
+#endif
+
+} // namespace detail
+
+#endif // STATS_H_
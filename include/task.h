@@ -0,0 +1,132 @@
+#ifndef TASK_H_
+#define TASK_H_
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only void() callable that keeps callables of up to Size bytes in place
+//
+// Bigger callables, over-aligned ones and those that may throw while moving go to the heap instead.
+// Trivially copyable callables are moved with a plain memcpy of the buffer.
+template <std::size_t Size>
+class InplaceTask {
+public:
+    static constexpr std::size_t kSize = Size;
+
+    // Whether F is stored without allocating
+    template <typename F>
+    static constexpr bool kInline = sizeof(F) <= Size && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+
+    InplaceTask() noexcept = default;
+
+    template <typename F>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, InplaceTask> && std::is_invocable_v<std::decay_t<F>&>)
+    InplaceTask(F&& function)
+    {
+        using Function = std::decay_t<F>;
+
+        if constexpr (kInline<Function>) {
+            ::new (static_cast<void*>(storage_)) Function(std::forward<F>(function));
+            ops_ = &kInlineOps<Function>;
+        } else {
+            ::new (static_cast<void*>(storage_)) Function*(new Function(std::forward<F>(function)));
+            ops_ = &kHeapOps<Function>;
+        }
+    }
+
+    ~InplaceTask()
+    {
+        Reset();
+    }
+
+    InplaceTask(const InplaceTask&) = delete;
+    InplaceTask& operator=(const InplaceTask&) = delete;
+
+    InplaceTask(InplaceTask&& other) noexcept
+    {
+        Take(other);
+    }
+
+    InplaceTask& operator=(InplaceTask&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            Take(other);
+        }
+
+        return *this;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops_ != nullptr;
+    }
+
+    void operator()()
+    {
+        ops_->invoke(storage_);
+    }
+
+    void Reset() noexcept
+    {
+        if (ops_ && ops_->destroy)
+            ops_->destroy(storage_);
+
+        ops_ = nullptr;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*move)(void*, void*) noexcept; // Null for a memcpy
+        void (*destroy)(void*) noexcept; // Null if there's nothing to do
+    };
+
+    template <typename Function>
+    static Function& As(void* storage) noexcept
+    {
+        return *std::launder(reinterpret_cast<Function*>(storage));
+    }
+
+    template <typename Function>
+    static constexpr Ops kInlineOps {
+        [](void* storage) { std::invoke(As<Function>(storage)); },
+        std::is_trivially_copyable_v<Function> ? nullptr : +[](void* to, void* from) noexcept {
+            ::new (to) Function(std::move(As<Function>(from)));
+            As<Function>(from).~Function();
+        },
+        std::is_trivially_destructible_v<Function> ? nullptr : +[](void* storage) noexcept { As<Function>(storage).~Function(); },
+    };
+
+    template <typename Function>
+    static constexpr Ops kHeapOps {
+        [](void* storage) { std::invoke(*As<Function*>(storage)); },
+        nullptr,
+        [](void* storage) noexcept { delete As<Function*>(storage); },
+    };
+
+    void Take(InplaceTask& other) noexcept
+    {
+        ops_ = std::exchange(other.ops_, nullptr);
+
+        if (!ops_)
+            return;
+
+        if (ops_->move)
+            ops_->move(storage_, other.storage_);
+        else
+            std::memcpy(storage_, other.storage_, sizeof(storage_));
+    }
+
+    alignas(std::max_align_t) std::byte storage_[Size < sizeof(void*) ? sizeof(void*) : Size];
+    const Ops* ops_ { nullptr };
+};
+
+// Room for a capture of 8 pointers
+using Task = InplaceTask<64>;
+
+#endif // TASK_H_
@@ -0,0 +1,257 @@
+#ifndef TASK_GRAPH_H_
+#define TASK_GRAPH_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "task.h"
+
+// Tasks with dependencies between them, run on an Executor as many times as needed
+//
+// Every node counts the dependencies it still waits for, and the node finishing last hands it on directly:
+// the first successor it readies runs inline on the same thread, the others get posted. Nodes are never queued
+// before they're ready. The counters live in a run state kept from one Run() to the next, so running the graph
+// again allocates nothing, unless tasks of the last run still sit in a queue holding on to it.
+// Not thread-safe, nodes are added while the graph isn't running, and it has to stay acyclic.
+class TaskGraph {
+public:
+    using Node = std::size_t;
+
+    TaskGraph() = default;
+    ~TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+    TaskGraph(TaskGraph&&) noexcept = default;
+    TaskGraph& operator=(TaskGraph&&) noexcept = default;
+
+    // Adds a node running function once per Run(), after every node in dependencies
+    template <typename F>
+    Node Add(F&& function, std::initializer_list<Node> dependencies = {})
+    {
+        const auto node = nodes_.size();
+
+        nodes_.push_back({ Task { std::forward<F>(function) }, {}, 0 });
+
+        for (auto dependency : dependencies)
+            Depend(node, dependency);
+
+        return node;
+    }
+
+    // Makes node run after dependency
+    void Depend(Node node, Node dependency)
+    {
+        assert(node < nodes_.size() && dependency < nodes_.size() && node != dependency);
+
+        nodes_[dependency].successors.push_back(node);
+        ++nodes_[node].dependencies;
+    }
+
+    std::size_t Size() const noexcept
+    {
+        return nodes_.size();
+    }
+
+    bool Empty() const noexcept
+    {
+        return nodes_.empty();
+    }
+
+    // Runs every node once on executor and the calling thread, returns once all of them went through
+    //
+    // The caller starts with the first root and then runs posted nodes that no worker took yet, so graphs may
+    // be run from within a worker. After the first exception, the remaining nodes are skipped and it's rethrown here.
+    template <typename Executor>
+    void Run(Executor& executor)
+    {
+        if (nodes_.empty())
+            return;
+
+        auto state = Prepare();
+        auto first = kNone;
+
+        for (Node node = 0; node < nodes_.size(); ++node) {
+            if (nodes_[node].dependencies != 0)
+                continue;
+
+            if (first == kNone && state->Claim(node))
+                first = node;
+            else
+                Post(executor, state, node);
+        }
+
+        assert(first != kNone && "A graph needs at least one node without dependencies");
+
+        Execute(executor, state, first);
+        Wait(executor, state);
+
+        if (state->error)
+            std::rethrow_exception(std::exchange(state->error, nullptr));
+    }
+
+private:
+    static constexpr Node kNone = std::numeric_limits<Node>::max();
+
+    struct Vertex {
+        Task task;
+        std::vector<Node> successors;
+        std::size_t dependencies;
+    };
+
+    // Counters of a single run, any queued task of it holds a reference
+    struct State {
+        struct Slot {
+            std::atomic_size_t remaining { 0 };
+            std::atomic_bool claimed { false };
+        };
+
+        explicit State(std::size_t size)
+            : size { size }
+            , slots { std::make_unique<Slot[]>(size) }
+            , posted { std::make_unique<std::atomic<Node>[]>(size) }
+        {
+        }
+
+        bool Claim(Node node) noexcept
+        {
+            return !slots[node].claimed.exchange(true, std::memory_order_acquire);
+        }
+
+        // Wakes the caller waiting in Run()
+        void Signal() noexcept
+        {
+            epoch.fetch_add(1, std::memory_order_release);
+            epoch.notify_all();
+        }
+
+        void Fail(std::exception_ptr exception)
+        {
+            std::lock_guard lock { mutex };
+
+            if (!error)
+                error = std::move(exception);
+
+            failed.store(true, std::memory_order_relaxed);
+        }
+
+        const std::size_t size;
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<std::atomic<Node>[]> posted; // Nodes posted so far, for the caller to claim while it waits
+        std::atomic_size_t count { 0 };
+        std::atomic_size_t pending { 0 }; // Nodes not done yet
+        std::atomic_uint32_t epoch { 0 };
+        std::atomic_bool failed { false };
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+
+    // Resets the counters of the last run, unless the graph grew or queued tasks of that run still hold them
+    std::shared_ptr<State> Prepare()
+    {
+        if (!state_ || state_.use_count() != 1 || state_->size != nodes_.size())
+            state_ = std::make_shared<State>(nodes_.size());
+
+        for (Node node = 0; node < nodes_.size(); ++node) {
+            state_->slots[node].remaining.store(nodes_[node].dependencies, std::memory_order_relaxed);
+            state_->slots[node].claimed.store(false, std::memory_order_relaxed);
+            state_->posted[node].store(kNone, std::memory_order_relaxed);
+        }
+
+        state_->count.store(0, std::memory_order_relaxed);
+        state_->pending.store(nodes_.size(), std::memory_order_relaxed);
+        state_->failed.store(false, std::memory_order_relaxed);
+        state_->error = nullptr;
+
+        return state_;
+    }
+
+    // A node that didn't make it into a queue still gets claimed by the caller
+    template <typename Executor>
+    void Post(Executor& executor, const std::shared_ptr<State>& state, Node node)
+    {
+        state->posted[state->count.fetch_add(1, std::memory_order_relaxed)].store(node, std::memory_order_release);
+        state->Signal();
+
+        // Once claimed elsewhere, the task only touches the state, which may belong to a finished run by then
+        executor.Post([this, &executor, state, node] {
+            if (state->Claim(node))
+                Execute(executor, state, node);
+        });
+    }
+
+    // Runs node, then the first successor it readies and so on, posting the other ones
+    template <typename Executor>
+    void Execute(Executor& executor, const std::shared_ptr<State>& state, Node node)
+    {
+        while (node != kNone) {
+            auto& vertex = nodes_[node];
+            auto next = kNone;
+
+            if (!state->failed.load(std::memory_order_relaxed)) {
+                try {
+                    vertex.task();
+                } catch (...) {
+                    state->Fail(std::current_exception());
+                }
+            }
+
+            for (auto successor : vertex.successors) {
+                if (state->slots[successor].remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    continue;
+
+                if (next == kNone && state->Claim(successor))
+                    next = successor;
+                else
+                    Post(executor, state, successor);
+            }
+
+            if (state->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                state->Signal();
+
+            node = next;
+        }
+    }
+
+    // Claims posted nodes in the order they were posted, sleeping while there's none left to claim
+    template <typename Executor>
+    void Wait(Executor& executor, const std::shared_ptr<State>& state)
+    {
+        std::size_t scan = 0;
+
+        while (state->pending.load(std::memory_order_acquire) != 0) {
+            const auto epoch = state->epoch.load(std::memory_order_acquire);
+            auto claimed = false;
+
+            for (; scan < state->count.load(std::memory_order_acquire); ++scan) {
+                const auto node = state->posted[scan].load(std::memory_order_acquire);
+
+                // Its slot is being filled in, Signal() follows
+                if (node == kNone)
+                    break;
+
+                if (state->Claim(node)) {
+                    ++scan;
+                    Execute(executor, state, node);
+                    claimed = true;
+                    break;
+                }
+            }
+
+            if (!claimed && state->pending.load(std::memory_order_acquire) != 0)
+                state->epoch.wait(epoch, std::memory_order_acquire);
+        }
+    }
+
+    std::vector<Vertex> nodes_;
+    std::shared_ptr<State> state_;
+};
+
+#endif // TASK_GRAPH_H_
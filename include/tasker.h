@@ -2,296 +2,2924 @@
 #define TASKER_H_
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <span>
 #include <thread>
 #include <vector>
 
+#include "block_allocator.h"
+#include "bound.h"
 #include "concurrent_queue.h"
+#include "coroutine.h"
+#include "event_queue.h"
+#include "future.h"
+#include "job.h"
+#include "parallel.h"
+#include "platform.h"
+#include "priority_queue.h"
+#include "ring_queue.h"
+#include "spsc_queue.h"
+#include "stats.h"
+#include "task.h"
+#include "task_graph.h"
+#include "thread_cache.h"
+#include "timer_wheel.h"
+#include "trace.h"
+#include "wait_policy.h"
+#include "work_stealing_deque.h"
+#include "worker_pool.h"
+
+// Selects batched consumption, where workers hand up to size items at once to Function(std::span<T>)
+// or Derived::Process(std::span<T>)
+struct Batch {
+    std::size_t size;
+};
+
+// Lets a Tasker with more than one worker run up to max of them under load, N staying the minimum
+//
+// A Post that finds the chosen queue holding depth items or more, or that has to wait for it, wakes up an extra worker
+// or starts one. Extra workers only steal, so Post keeps indexing the same N queues, and retire after idle without work.
+struct Elastic {
+    std::size_t max { 0 }; // Up to N keeps the worker count fixed
+    std::size_t depth { 64 };
+    std::chrono::milliseconds idle { 100 };
+};
+
+// How Post picks the worker queue an item goes to, with more than one worker
+enum class Placement {
+    RoundRobin, // A shared counter spreads items evenly, the next queues being tried while one is locked
+    Affinity, // Every producer thread sticks to a queue of its own, leaving the spreading to stealing
+    TwoChoices, // The shorter of two random queues by their relaxed sizes, which steers items away from slow workers
+};
+
+// Wait, placement and elastic are ignored under a Static policy, which fixes them at compile time
+struct TaskerOptions {
+    WaitPolicy wait {};
+    Affinity affinity {};
+    Placement placement {};
+    Bound bound {}; // For the whole Tasker, split evenly across the workers
+    Elastic elastic {}; // Ignored with N = 1, which keeps its single worker
+    bool lazy { false }; // Starts the workers with the first item posted rather than in the constructor
+};
+
+// Leaves waiting, placement and growth to TaskerOptions, at run time
+struct Dynamic {
+    static constexpr bool kStatic = false;
+};
+
+// Settles waiting, placement and growth at compile time, the matching fields of TaskerOptions being ignored
+//
+// Without Grows, a Tasker keeps exactly N workers in a std::array and, N being a power of two, picks their queues
+// with a mask rather than a division. Queue type and capacity are template arguments already, stats a macro.
+template <Placement P = Placement::RoundRobin, WaitPolicy Wait = WaitPolicy {}, bool Grows = false>
+struct Static {
+    static constexpr bool kStatic = true;
+    static constexpr Placement kPlacement = P;
+    static constexpr WaitPolicy kWait = Wait;
+    static constexpr bool kGrows = Grows;
+};
+
+namespace detail {
+
+template <typename Policy>
+const WaitPolicy& WaitOf(const TaskerOptions& options) noexcept
+{
+    if constexpr (Policy::kStatic)
+        return Policy::kWait;
+    else
+        return options.wait;
+}
+
+template <typename Policy>
+Placement PlacementOf(const TaskerOptions& options) noexcept
+{
+    if constexpr (Policy::kStatic)
+        return Policy::kPlacement;
+    else
+        return options.placement;
+}
+
+template <typename Policy>
+constexpr bool kGrows = [] {
+    if constexpr (Policy::kStatic)
+        return Policy::kGrows;
+    else
+        return true;
+}();
+
+template <typename Function, typename T>
+using ResultOf = std::decay_t<std::invoke_result_t<Function&, T&&>>;
+
+// Queues like SpscQueue, which only the N = 1 specializations can use with a single thread posting
+template <typename Queue>
+concept SingleProducer = requires { requires Queue::kSingleProducer; };
+
+// What Derived::Process(T&&) returns, void if it only processes batches
+template <typename Derived, typename T>
+struct ProcessResult {
+    using type = void;
+};
+
+template <typename Derived, typename T>
+    requires requires(Derived& derived, T&& value) { derived.Process(std::move(value)); }
+struct ProcessResult<Derived, T> {
+    using type = std::decay_t<decltype(std::declval<Derived&>().Process(std::declval<T>()))>;
+};
+
+// Processes one item and hands the outcome over to its job, if any
+//
+// Without a job, exceptions escape to the worker as they always did. With one, they go to its Future.
+template <typename T, typename Process>
+void Execute(Item<T>&& item, Process& process)
+{
+    auto* job = item.Release();
+
+    if (!job) {
+        process(std::move(item.Value()));
+        return;
+    }
+
+    switch (job->GetKind()) {
+    case Job::Kind::Resume:
+        job->Resume();
+        break;
+    case Job::Kind::Signal: {
+        auto* state = static_cast<FutureState<void>*>(job);
+
+        try {
+            process(std::move(item.Value()));
+            state->SetValue();
+        } catch (...) {
+            state->SetException(std::current_exception());
+        }
+
+        break;
+    }
+    case Job::Kind::Complete:
+        if constexpr (!std::is_void_v<ResultOf<Process, T>>) {
+            auto* state = static_cast<FutureState<ResultOf<Process, T>>*>(job);
+
+            try {
+                state->SetValue(process(std::move(item.Value())));
+            } catch (...) {
+                state->SetException(std::current_exception());
+            }
+        } else {
+            // Submit<R> with a result the function doesn't return, which only asserts in debug builds, gets no value
+            job->Abandon();
+            process(std::move(item.Value()));
+        }
+
+        break;
+    }
+}
+
+// Values of a batch in a contiguous buffer, plus the jobs that came along with them
+template <typename T>
+class BatchBuffer {
+public:
+    // Output iterator for PopBulk
+    class Inserter {
+    public:
+        using difference_type = std::ptrdiff_t;
+
+        explicit Inserter(BatchBuffer& buffer) noexcept
+            : buffer_ { &buffer }
+        {
+        }
+
+        Inserter& operator=(Item<T>&& item)
+        {
+            buffer_->Push(std::move(item));
+
+            return *this;
+        }
+
+        Inserter& operator*() noexcept
+        {
+            return *this;
+        }
+
+        Inserter& operator++() noexcept
+        {
+            return *this;
+        }
+
+        Inserter operator++(int) noexcept
+        {
+            return *this;
+        }
+
+    private:
+        BatchBuffer* buffer_;
+    };
+
+    // Items gathered are counted as executed in stats, except for skip which only wakes the worker up
+    BatchBuffer(std::size_t size, Counters& stats, const Job* skip = nullptr)
+        : stats_ { &stats }
+        , skip_ { skip }
+    {
+        values_.reserve(size);
+    }
+
+    bool Empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    std::size_t Size() const noexcept
+    {
+        return size_;
+    }
+
+    Inserter Back() noexcept
+    {
+        return Inserter { *this };
+    }
+
+    void Push(Item<T>&& item)
+    {
+        if (item.GetJob() != skip_ || item.HasValue())
+            stats_->Executed(item.GetStamp());
+
+        if (item.HasValue())
+            values_.push_back(std::move(item.Value()));
+
+        if (auto* job = item.Release())
+            jobs_.push_back(job);
+
+        ++size_;
+    }
+
+    // Completes every job once the whole batch went through process(std::span<T>)
+    //
+    // An exception goes to the futures of the batch, or escapes to the worker if there are none.
+    template <typename Process>
+    void Flush(Process& process)
+    {
+        std::exception_ptr error;
+        auto reported = false;
+
+        try {
+            if (!values_.empty())
+                process(std::span<T> { values_ });
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        for (auto* job : jobs_) {
+            assert(job->GetKind() != Job::Kind::Complete);
+
+            if (job->GetKind() == Job::Kind::Resume) {
+                job->Resume();
+                continue;
+            }
+
+            if (error)
+                static_cast<FutureState<void>*>(job)->SetException(error);
+            else
+                static_cast<FutureState<void>*>(job)->SetValue();
+
+            reported = true;
+        }
+
+        Reset();
+
+        if (error && !reported)
+            std::rethrow_exception(error);
+    }
+
+private:
+    void Reset() noexcept
+    {
+        values_.clear();
+        jobs_.clear();
+        size_ = 0;
+    }
+
+    std::vector<T> values_;
+    std::vector<Job*> jobs_;
+    std::size_t size_ { 0 };
+    Counters* stats_;
+    const Job* skip_;
+};
+
+// Output iterator that drops whatever is written to it, where Abort() has nowhere to put the leftovers
+struct Discard {
+    using difference_type = std::ptrdiff_t;
+
+    template <typename U>
+    Discard& operator=(U&&) noexcept
+    {
+        return *this;
+    }
+
+    Discard& operator*() noexcept
+    {
+        return *this;
+    }
+
+    Discard& operator++() noexcept
+    {
+        return *this;
+    }
+
+    Discard operator++(int) noexcept
+    {
+        return *this;
+    }
+};
+
+// Hands the value of an item that never ran over to out, the item abandons its job on the way out
+template <typename T, typename OutputIt>
+void HandOver(Item<T>&& item, OutputIt& out)
+{
+    if (item.HasValue())
+        *out++ = std::move(item.Value());
+}
+
+// Owner-only counters go up with a plain store
+inline void Bump(std::atomic_size_t& counter, std::size_t count = 1) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+// Where WaitIdle() sleeps until the workers report running out of work
+//
+// Workers only take the lock when somebody waits, which they learn from the light fence pairing with the heavy one here.
+class IdleSignal {
+public:
+    // idle() reads what the workers published
+    template <typename Idle>
+    void Wait(Idle idle)
+    {
+        Enter();
+
+        {
+            std::unique_lock lock { mutex_ };
+
+            cv_.wait(lock, idle);
+        }
+
+        Leave();
+    }
+
+    template <typename Idle>
+    bool WaitUntil(std::chrono::steady_clock::time_point deadline, Idle idle)
+    {
+        Enter();
+
+        auto done = false;
+
+        {
+            std::unique_lock lock { mutex_ };
+
+            done = cv_.wait_until(lock, deadline, idle);
+        }
+
+        Leave();
+
+        return done;
+    }
+
+    // Called once whatever makes idle() true is published
+    void Notify()
+    {
+        LightFence();
+
+        if (waiters_.load(std::memory_order_relaxed) == 0)
+            return;
+
+        // Either the waiter checks idle() after this or it's already asleep
+        {
+            std::lock_guard lock { mutex_ };
+        }
+
+        cv_.notify_all();
+    }
+
+private:
+    void Enter()
+    {
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        HeavyFence();
+    }
+
+    void Leave()
+    {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::atomic_size_t waiters_ { 0 };
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// Thread of a single worker, taken from the ThreadCache right away or with the first item posted
+class Launcher {
+public:
+    // Runs run now unless lazy, which leaves it to Ready()
+    void Launch(Task run, bool lazy)
+    {
+        {
+            std::lock_guard lock { mutex_ };
+
+            run_ = std::move(run);
+            stopping_ = false;
+            started_.store(false, std::memory_order_relaxed);
+        }
+
+        if (!lazy)
+            Start();
+    }
+
+    // Starts the worker unless it runs already, a relaxed load on every post once it does
+    void Ready()
+    {
+        if (!started_.load(std::memory_order_relaxed))
+            Start();
+    }
+
+    // Nothing starts from now on, until the next Launch()
+    void Stop()
+    {
+        std::lock_guard lock { mutex_ };
+
+        stopping_ = true;
+        run_.Reset();
+    }
+
+    // After Stop(), waits for the worker if it ever started
+    void Join()
+    {
+        if (thread_.valid())
+            thread_.get();
+    }
+
+    // False if the worker still runs once timeout passed
+    template <typename Rep, typename Period>
+    bool JoinFor(std::chrono::duration<Rep, Period> timeout)
+    {
+        return !thread_.valid() || thread_.wait_for(timeout) != std::future_status::timeout;
+    }
+
+    // Stopped and joined, or never launched
+    bool Joined() const
+    {
+        std::lock_guard lock { mutex_ };
+
+        return !run_ && !thread_.valid();
+    }
+
+private:
+    void Start()
+    {
+        std::lock_guard lock { mutex_ };
+
+        if (stopping_ || !run_)
+            return;
+
+        thread_ = ThreadCache::Instance().Run(std::move(run_));
+        started_.store(true, std::memory_order_relaxed);
+    }
+
+    mutable std::mutex mutex_;
+    Task run_;
+    std::future<void> thread_;
+    std::atomic_bool started_ { false };
+    bool stopping_ { false };
+};
+
+// How BlockingScope reaches the worker running on this thread, whichever Tasker it belongs to
+struct BlockingHook {
+    void* owner { nullptr };
+    std::size_t index { 0 };
+    void (*enter)(void*, std::size_t) { nullptr };
+    void (*leave)(void*, std::size_t) { nullptr };
+    std::size_t depth { 0 }; // Only the outermost scope tells the owner
+};
+
+inline thread_local BlockingHook blocking_hook;
+
+// Scheduling shared by Tasker and TaskerBase with more than one worker
+//
+// Every worker owns an inbox Queue for posted items and a WorkStealingDeque. The owner pops its deque at the bottom
+// and refills it from its inbox, idle workers steal from the top of other deques (then their inboxes)
+// starting from a random victim. Items posted from a worker go straight into its own deque unless somebody sleeps.
+// Keyed items go to a third queue per worker that only its owner pops, which keeps them in order.
+// With a PriorityQueue or a Bound, everything goes through the inboxes one item at a time so that lanes and capacity
+// are never bypassed.
+template <typename T, std::size_t N, typename Queue, typename Policy>
+class TaskerCore {
+    static_assert(std::is_same_v<typename Queue::value_type, T>);
+    static_assert(!SingleProducer<Queue>, "Workers post to and steal from each other's queues");
+
+    static constexpr bool kPrioritized = requires { Queue::kLevels; };
+    static constexpr bool kFixed = !kGrows<Policy> && N != 0; // Exactly N workers, known at compile time
+
+public:
+    // Fails once stopped, or when the Tasker is full and rejects
+    template <typename... Args>
+    bool Post(Args&&... args)
+    {
+        return Dispatch<true>(std::in_place, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+        requires(kPrioritized)
+    bool Post(Priority priority, Args&&... args)
+    {
+        return Dispatch<true>(priority, std::in_place, std::forward<Args>(args)...);
+    }
+
+    // Like Post but fails instead of blocking when the Tasker is full
+    template <typename... Args>
+    bool TryPost(Args&&... args)
+    {
+        return Dispatch<false>(std::in_place, std::forward<Args>(args)...);
+    }
+
+    // Items with equal keys always go to the same worker, which processes them in order and never lets them be stolen
+    template <typename Key, typename... Args>
+    bool PostKeyed(const Key& key, Args&&... args)
+    {
+        const auto n = Wrap(std::hash<Key> {}(key));
+
+        Ready();
+        posted_.fetch_add(1, std::memory_order_relaxed);
+
+        if (!workers_[n]->keyed.Emplace(std::in_place, std::forward<Args>(args)...)) {
+            Drop(1);
+            return false;
+        }
+
+        workers_[n]->stats.Posted();
+        Wake(n);
+
+        return true;
+    }
+
+    // Posts the item once delay has passed, from a timer thread that starts with the first delayed item
+    template <typename Rep, typename Period, typename... Args>
+    Timer PostAfter(std::chrono::duration<Rep, Period> delay, Args&&... args)
+    {
+        return PostAt(std::chrono::steady_clock::now() + delay, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    Timer PostAt(std::chrono::steady_clock::time_point due, Args&&... args)
+    {
+        return timers_.Schedule(due, {}, T(std::forward<Args>(args)...));
+    }
+
+    // Posts a copy of the item every period, starting one period from now
+    template <typename Rep, typename Period, typename... Args>
+        requires(std::is_copy_constructible_v<T>)
+    Timer PostEvery(std::chrono::duration<Rep, Period> period, Args&&... args)
+    {
+        const auto every = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+
+        return timers_.Schedule(std::chrono::steady_clock::now() + every, every, T(std::forward<Args>(args)...));
+    }
+
+    // False if the item was already posted or cancelled, a periodic one stops repeating
+    bool Cancel(Timer timer)
+    {
+        return timers_.Cancel(timer);
+    }
+
+    template <typename... Args>
+        requires(kPrioritized)
+    bool TryPost(Priority priority, Args&&... args)
+    {
+        return Dispatch<false>(priority, std::in_place, std::forward<Args>(args)...);
+    }
+
+    // Items queued and not yet taken by a worker, from relaxed counters, so it's cheap enough to poll for load shedding
+    std::size_t Size() const
+    {
+        std::size_t size = 0;
+
+        for (const auto& worker : workers_)
+            size += worker->queue.Size() + worker->keyed.Size() + worker->deque.Size();
+
+        return size;
+    }
+
+    // One entry per worker, read with relaxed loads while they keep running, so counters may be slightly apart
+    std::vector<WorkerStats> Snapshot() const
+    {
+        std::vector<WorkerStats> snapshot(workers_.size());
+
+        for (std::size_t n = 0; n < workers_.size(); ++n) {
+            const auto& worker = *workers_[n];
+
+            snapshot[n].depth = worker.queue.Size() + worker.keyed.Size() + worker.deque.Size();
+            worker.stats.Read(snapshot[n]);
+        }
+
+        return snapshot;
+    }
+
+    // Latest events of sampled items across workers, sorted by time, empty unless built with TASKER_USE_TRACE
+    std::vector<TraceRecord> Trace() const
+    {
+        std::vector<TraceRecord> records;
+
+        for (const auto& worker : workers_)
+            worker->trace.Read(records);
+
+        std::ranges::stable_sort(records, {}, &TraceRecord::time);
+
+        return records;
+    }
+
+    // co_await Schedule() resumes the coroutine on a worker, the handle is queued by itself without any wrapper
+    auto Schedule() noexcept
+    {
+        return Hop { [this](Job* job) { return Dispatch<true>(job); } };
+    }
+
+    // Splits [first, last) into at most one chunk per worker, each pushed under a single lock
+    //
+    // Returns how many items went in, which is less than the whole range only with Overflow::Reject or once stopped.
+    template <std::forward_iterator ForwardIt, std::sentinel_for<ForwardIt> Sentinel>
+    std::size_t PostBulk(ForwardIt first, Sentinel last)
+    {
+        const auto size = static_cast<std::size_t>(std::ranges::distance(first, last));
+        std::size_t count = 0;
+
+        if (size == 0)
+            return count;
+
+        const auto chunks = std::min(base_, (size + kChunkSize - 1) / kChunkSize);
+        const auto index = Unblocked(Pick(chunks));
+
+        Ready();
+        posted_.fetch_add(size, std::memory_order_relaxed);
+
+        for (std::size_t n = 0, begin = 0; n < chunks; ++n) {
+            const auto end = size * (n + 1) / chunks;
+            auto next = std::ranges::next(first, static_cast<std::iter_difference_t<ForwardIt>>(end - begin));
+
+            auto& worker = *workers_[Wrap(index + n)];
+            const auto pushed = worker.queue.PushBulk(first, next);
+
+            worker.stats.Posted(pushed);
+            Demand(worker);
+            count += pushed;
+            first = next;
+            begin = end;
+        }
+
+        if (count != size)
+            Drop(size - count);
+
+        return count;
+    }
+
+    template <std::ranges::forward_range Range>
+    std::size_t PostRange(Range&& range)
+    {
+        return PostBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    void Clear()
+    {
+        std::size_t count = 0;
+
+        for (auto& worker : workers_) {
+            count += worker->keyed.Clear();
+            count += worker->queue.Clear();
+        }
+
+        if (count != 0)
+            Drop(count);
+    }
+
+    // Stops taking items in and returns right away, the workers go on with what's queued and exit once it's drained
+    void RequestStop()
+    {
+        stopping_.store(true, std::memory_order_release);
+
+        {
+            std::lock_guard lock { elastic_.mutex };
+
+            elastic_.stopping = true;
+        }
+
+        elastic_.cv.notify_all();
+
+        for (auto& worker : workers_) {
+            worker->keyed.Stop();
+            worker->queue.Stop();
+        }
+
+        // Last, as the timer thread may be blocked posting into a full queue that aborting workers no longer drain
+        timers_.Stop();
+    }
+
+    // Blocks until everything posted so far went through and every worker ran out of work, without polling Size()
+    //
+    // Delayed items only count once they're due. Called from a worker, it would wait for itself.
+    void WaitIdle()
+    {
+        quiet_.Wait([this] { return Idle(); });
+    }
+
+    // False if the workers are still busy once timeout passed
+    template <typename Rep, typename Period>
+    bool WaitIdleFor(std::chrono::duration<Rep, Period> timeout)
+    {
+        return quiet_.WaitUntil(std::chrono::steady_clock::now() + timeout, [this] { return Idle(); });
+    }
+
+    // Loop that worker n handles I/O on while it's idle, with an EventQueue
+    EventLoop& Events(std::size_t n)
+        requires requires(typename Queue::template rebind<Item<T>>& inbox) { inbox.Events(); }
+    {
+        Ready();
+
+        return workers_[n]->queue.Events();
+    }
+
+protected:
+    static constexpr std::size_t kRefillSize = 32;
+    static constexpr std::size_t kChunkSize = 64;
+
+    using Deque = WorkStealingDeque<Item<T>>;
+    using Inbox = typename Queue::template rebind<Item<T>>;
+
+    explicit TaskerCore(TaskerOptions options)
+        : options_ { std::move(options) }
+    {
+        if constexpr (!kFixed)
+            workers_.resize(count_);
+
+        // Each worker's state lives on the NUMA node it's pinned to
+        for (std::size_t n = 0; n < count_; ++n)
+            workers_[n] = MakeOnNode<Worker>(NodeOf(options_.affinity, n), Share(options_.bound, n));
+    }
+
+    ~TaskerCore() = default;
+
+    // run(n) runs worker n until it returns, called on a cached thread for each base worker and for each extra one started
+    //
+    // Base workers start right away, or with the first item posted if the Tasker is lazy.
+    void Launch(std::function<void(std::size_t)> run)
+    {
+        {
+            std::lock_guard lock { elastic_.mutex };
+
+            elastic_.run = std::move(run);
+            elastic_.threads.resize(count_);
+            elastic_.spare.clear();
+
+            for (std::size_t n = count_; n > base_; --n)
+                elastic_.spare.push_back(n - 1);
+
+            elastic_.spares.store(elastic_.spare.size(), std::memory_order_relaxed);
+        }
+
+        if (!options_.lazy || Size() != 0)
+            StartWorkers();
+    }
+
+    // Starts the base workers unless they run already, a relaxed load on every post once they do
+    void Ready()
+    {
+        if (!started_.load(std::memory_order_relaxed))
+            StartWorkers();
+    }
+
+    // Stops timers and queues and waits for every worker, which drain what's left in their queues first
+    void Join()
+    {
+        RequestStop();
+        JoinWorkers();
+    }
+
+    // Like Join() until deadline, past which the workers only finish what they're running and leave the rest to out
+    template <typename OutputIt>
+    std::size_t JoinUntil(std::chrono::steady_clock::time_point deadline, OutputIt out)
+    {
+        RequestStop();
+
+        for (auto& thread : elastic_.threads) {
+            if (thread.valid() && thread.wait_until(deadline) == std::future_status::timeout) {
+                aborting_.store(true, std::memory_order_relaxed);
+                break;
+            }
+        }
+
+        JoinWorkers();
+
+        return Leftovers(out);
+    }
+
+    // Like Join() past the deadline right away
+    template <typename OutputIt>
+    std::size_t JoinNow(OutputIt out)
+    {
+        aborting_.store(true, std::memory_order_relaxed);
+        RequestStop();
+        JoinWorkers();
+
+        return Leftovers(out);
+    }
+
+    template <typename Process>
+    void Work(std::size_t n, Process& process)
+    {
+        auto& queue = workers_[n]->queue;
+        auto& keyed = workers_[n]->keyed;
+        auto& deque = workers_[n]->deque;
+        auto& stats = workers_[n]->stats;
+        auto& trace = workers_[n]->trace;
+        auto& done = workers_[n]->done;
+        std::minstd_rand random { static_cast<std::minstd_rand::result_type>(n + 1) };
+
+        Pin(options_.affinity, n);
+        current_ = { this, n };
+        blocking_hook = { this, n, &EnterBlocking, &LeaveBlocking };
+
+        while (!aborting_.load(std::memory_order_relaxed)) {
+            auto value = deque.Pop();
+
+            if (!value)
+                value = keyed.TryPop();
+
+            if (!value)
+                value = Refill(n);
+
+            if (!value)
+                value = Steal(n, random);
+
+            if (!value) {
+                auto running = true;
+
+                quiet_.Notify();
+                idle_.fetch_add(1, std::memory_order_relaxed);
+
+                if (value = Spin(n, random); !value)
+                    running = Park(n, [&] { return (value = queue.Pop()).has_value(); });
+
+                idle_.fetch_sub(1, std::memory_order_relaxed);
+
+                if (!running)
+                    break;
+                else if (!value)
+                    continue;
+            }
+
+            if (value->GetJob() != &nudge_)
+                stats.Executed(value->GetStamp());
+
+            const auto tag = value->GetTrace();
+
+            trace.Start(tag, n);
+            Execute(*std::move(value), process);
+            trace.Finish(tag, n);
+            Bump(done);
+        }
+
+        // Extra workers never get keyed items, and their keyed queue is only stopped along with the others
+        while (auto value = n < base_ && !aborting_.load(std::memory_order_relaxed) ? keyed.Pop() : std::nullopt) {
+            const auto tag = value->GetTrace();
+
+            stats.Executed(value->GetStamp());
+            trace.Start(tag, n);
+            Execute(*std::move(value), process);
+            trace.Finish(tag, n);
+            Bump(done);
+        }
+
+        quiet_.Notify();
+
+        current_ = {};
+        blocking_hook = {};
+    }
+
+    template <typename Process>
+    void WorkBatch(std::size_t n, std::size_t size, Process& process)
+    {
+        auto& queue = workers_[n]->queue;
+        auto& keyed = workers_[n]->keyed;
+        auto& deque = workers_[n]->deque;
+        auto& done = workers_[n]->done;
+        std::minstd_rand random { static_cast<std::minstd_rand::result_type>(n + 1) };
+        BatchBuffer<T> items { size, workers_[n]->stats, &nudge_ };
+
+        Pin(options_.affinity, n);
+        current_ = { this, n };
+        blocking_hook = { this, n, &EnterBlocking, &LeaveBlocking };
+
+        // Whatever a batch holds went through once it's flushed
+        auto flush = [&] {
+            const auto count = items.Size();
+
+            items.Flush(process);
+            Bump(done, count);
+        };
+
+        while (!aborting_.load(std::memory_order_relaxed)) {
+            while (items.Size() < size) {
+                auto value = deque.Pop();
+
+                if (!value)
+                    break;
+
+                items.Push(*std::move(value));
+            }
+
+            if (items.Size() < size)
+                keyed.TryPopBulk(items.Back(), size - items.Size());
+
+            if (items.Size() < size)
+                queue.TryPopBulk(items.Back(), size - items.Size());
+
+            if (items.Empty()) {
+                if (auto value = Steal(n, random))
+                    items.Push(*std::move(value));
+            }
+
+            if (items.Empty()) {
+                auto running = true;
+
+                quiet_.Notify();
+                idle_.fetch_add(1, std::memory_order_relaxed);
+
+                if (auto value = Spin(n, random))
+                    items.Push(*std::move(value));
+                else
+                    running = Park(n, [&] { return queue.PopBulk(items.Back(), size) != 0; });
+
+                idle_.fetch_sub(1, std::memory_order_relaxed);
+
+                if (!running)
+                    break;
+                else if (items.Empty())
+                    continue;
+            }
+
+            flush();
+        }
+
+        while (n < base_ && !aborting_.load(std::memory_order_relaxed) && keyed.PopBulk(items.Back(), size) != 0)
+            flush();
+
+        quiet_.Notify();
+        current_ = {};
+        blocking_hook = {};
+    }
+
+    template <typename R, typename... Args>
+    Future<R> SubmitAs(Args&&... args)
+    {
+        Item<T> item { std::in_place, std::forward<Args>(args)... };
+        auto* state = futures_.template Make<R>();
+        auto future = MakeFuture(state);
+
+        // Left in item if the Tasker is stopped, which abandons it
+        item.Attach(state);
+        Dispatch<true>(std::move(item));
+
+        return future;
+    }
+
+    // Takes over what other still has queued once its workers are gone, the queues may not have a second consumer
+    void Take(TaskerCore& other)
+    {
+        other.aborting_.store(true, std::memory_order_relaxed);
+        other.RequestStop();
+        other.JoinWorkers();
+
+        // What this still had is replaced, and what it takes over is counted in before its workers can finish any of it
+        for (std::size_t n = 0; n < count_; ++n) {
+            auto& worker = *workers_[n];
+            auto& from = *other.workers_[n];
+            const auto count = from.queue.Size() + from.keyed.Size();
+
+            Drop(worker.queue.Clear() + worker.keyed.Clear());
+            posted_.fetch_add(count, std::memory_order_relaxed);
+            worker.queue = std::move(from.queue);
+            worker.keyed = std::move(from.keyed);
+            other.Drop(count);
+
+            // An owner parked on its inbox only looks at keyed items once nudged
+            if (!worker.keyed.Empty())
+                Wake(n);
+
+            while (auto value = from.deque.Steal()) {
+                posted_.fetch_add(1, std::memory_order_relaxed);
+                other.Drop(1);
+
+                if (!worker.queue.Emplace(*std::move(value)))
+                    Drop(1);
+            }
+        }
+
+        // A lazy Tasker getting items has to start, unless it's not launched yet and Launch() will see them
+        if (Size() != 0)
+            Ready();
+    }
+
+    // What's left in the queues once every worker is gone, handed over to out without the nudges
+    template <typename OutputIt>
+    std::size_t Leftovers(OutputIt& out)
+    {
+        std::size_t count = 0;
+        std::size_t dropped = 0;
+
+        auto leave = [&](Item<T>&& item) {
+            ++dropped;
+
+            if (item.GetJob() != &nudge_) {
+                ++count;
+                HandOver(std::move(item), out);
+            }
+        };
+
+        for (auto& worker : workers_) {
+            while (auto value = worker->deque.Pop())
+                leave(*std::move(value));
+
+            // Stopped queues only fail to pop while a late Post() holds the lock
+            for (auto* queue : { &worker->keyed, &worker->queue }) {
+                while (!queue->Empty()) {
+                    if (auto value = queue->TryPop())
+                        leave(*std::move(value));
+                }
+            }
+        }
+
+        if (dropped != 0)
+            Drop(dropped);
+
+        return count;
+    }
+
+    // Wakes an owner parked on its inbox when a keyed item comes in, doing nothing by itself
+    //
+    // It's stateless so that it survives Take(). A thief that steals one hands it back to the victim.
+    struct Nudge final : Job {
+        Nudge() noexcept
+            : Job { Kind::Resume }
+        {
+        }
+
+        void Abandon() noexcept override { }
+    };
+
+    // Padded so that neither the worker next door nor producers bumping index_ share its cache lines
+    struct alignas(kCacheLineSize) Worker {
+        explicit Worker(Bound bound)
+            : queue { bound }
+            , keyed { bound }
+        {
+        }
+
+        Inbox queue;
+        Inbox keyed;
+        Deque deque;
+        std::atomic_bool parked { false };
+        std::atomic_bool blocked { false }; // Inside a BlockingScope
+        [[no_unique_address]] Counters stats;
+        [[no_unique_address]] Tracer trace;
+
+        // Only the owner writes these, on a line of their own since WaitIdle() reads them
+        alignas(kCacheLineSize) std::atomic_size_t done { 0 }; // Items taken out of any queue and gone through
+        std::atomic_size_t spawned { 0 }; // Items posted straight into the own deque, which skip posted_
+    };
+
+    TaskerOptions options_;
+    std::size_t base_ { N != 0 ? N : std::max(1u, std::thread::hardware_concurrency()) };
+    std::size_t count_ { kGrows<Policy> ? std::max(base_, options_.elastic.max) : base_ }; // Including the slots of extra workers
+    std::conditional_t<kFixed, std::array<NodePtr<Worker>, N>, std::vector<NodePtr<Worker>>> workers_;
+    FuturePool futures_;
+    Timers<T> timers_ { [this](T&& value) { return Post(std::move(value)); } };
+    alignas(kCacheLineSize) std::atomic_size_t index_ { 0 };
+    std::atomic_size_t posted_ { 0 }; // Counted before the push, next to index_ which producers hold anyway
+    alignas(kCacheLineSize) std::atomic_size_t idle_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t dropped_ { 0 }; // Posted but cleared, rejected or left over
+    std::atomic_bool aborting_ { false };
+    std::atomic_bool stopping_ { false }; // Set before the queues stop, for posts that go to the own deque instead
+    std::atomic_size_t blocked_ { 0 }; // Workers inside a BlockingScope, rarely written so that posts can skip the check
+    std::atomic_bool started_ { false }; // Base workers running, only set once
+    IdleSignal quiet_;
+
+private:
+    struct Current {
+        const TaskerCore* owner { nullptr };
+        std::size_t index { 0 };
+    };
+
+    // What a producer thread places by, mixed from its id so that neighbouring threads land on different queues
+    struct Producer {
+        std::uint64_t home { Mix(std::hash<std::thread::id> {}(std::this_thread::get_id())) };
+        std::uint64_t state { home | 1 };
+
+        // xorshift64, cheap and good enough to pick queues
+        std::uint64_t Next() noexcept
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            return state;
+        }
+
+        static std::uint64_t Mix(std::uint64_t value) noexcept
+        {
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+
+            return value ^ (value >> 31);
+        }
+    };
+
+    // Worker n's part of the Tasker's capacity
+    Bound Share(Bound bound, std::size_t n) const noexcept
+    {
+        if (bound.capacity != 0)
+            bound.capacity = std::max<std::size_t>(bound.capacity / base_ + (n < bound.capacity % base_ ? 1 : 0), 1);
+
+        return bound;
+    }
+
+    // Takes Item<T> constructor arguments, fails once stopped, waits for room as the bound says if Wait is set
+    template <bool Wait, typename... Args>
+    bool Dispatch(Args&&... args)
+    {
+        // Keep it on this worker while every other worker is busy anyway, unless the deque would dodge the bound
+        if constexpr (!kPrioritized) {
+            if (current_.owner == this && idle_.load(std::memory_order_relaxed) == 0 && options_.bound.capacity == 0
+                && !workers_[current_.index]->blocked.load(std::memory_order_relaxed) && !stopping_.load(std::memory_order_acquire)) {
+                auto& worker = *workers_[current_.index];
+
+                Bump(worker.spawned);
+
+                if (worker.deque.TryEmplace(std::forward<Args>(args)...)) {
+                    worker.stats.Posted();
+                    return true;
+                }
+
+                worker.spawned.store(worker.spawned.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+            }
+        }
+
+        const auto index = Unblocked(Pick(1));
+        const auto tries = PlacementOf<Policy>(options_) == Placement::RoundRobin ? base_ : 1;
+
+        Ready();
+        posted_.fetch_add(1, std::memory_order_relaxed);
+
+        // Schedule task, waiting on the picked queue rather than cascading over the others unless round-robin
+        for (std::size_t n = 0; n < tries; ++n) {
+            auto& worker = *workers_[Wrap(index + n)];
+
+            if (worker.queue.TryEmplace(std::forward<Args>(args)...)) {
+                worker.stats.Posted();
+                Demand(worker);
+                return true;
+            }
+        }
+
+        auto& worker = *workers_[Wrap(index)];
+        auto posted = false;
+
+        worker.stats.Fallback();
+        Grow();
+
+        if constexpr (Wait)
+            posted = worker.queue.Emplace(std::forward<Args>(args)...);
+        else
+            posted = worker.queue.Offer(std::forward<Args>(args)...);
+
+        if (posted)
+            worker.stats.Posted();
+        else
+            Drop(1);
+
+        return posted;
+    }
+
+    // First of count consecutive queues to post to, only round-robin touching index_
+    std::size_t Pick(std::size_t count)
+    {
+        switch (PlacementOf<Policy>(options_)) {
+        case Placement::Affinity:
+            return Wrap(producer_.home);
+        case Placement::TwoChoices: {
+            const auto random = producer_.Next();
+            const auto first = Wrap(random >> 32);
+            const auto second = Wrap(random & 0xffffffff);
+
+            return workers_[second]->queue.Size() < workers_[first]->queue.Size() ? second : first;
+        }
+        default:
+            return index_.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    // Moves index past workers inside a BlockingScope, unless every one of them is
+    std::size_t Unblocked(std::size_t index) const
+    {
+        if (blocked_.load(std::memory_order_relaxed) == 0)
+            return index;
+
+        for (std::size_t n = 0; n < base_; ++n) {
+            if (!workers_[Wrap(index + n)]->blocked.load(std::memory_order_relaxed))
+                return index + n;
+        }
+
+        return index;
+    }
+
+    static void EnterBlocking(void* self, std::size_t n)
+    {
+        static_cast<TaskerCore*>(self)->Block(n);
+    }
+
+    static void LeaveBlocking(void* self, std::size_t n)
+    {
+        static_cast<TaskerCore*>(self)->Unblock(n);
+    }
+
+    // Steers posts away from worker n, wakes as many parked workers as it holds items to steal them, calls for a stand-in
+    void Block(std::size_t n)
+    {
+        auto& worker = *workers_[n];
+        auto pending = worker.queue.Size() + worker.deque.Size();
+
+        worker.blocked.store(true, std::memory_order_relaxed);
+        blocked_.fetch_add(1, std::memory_order_relaxed);
+
+        for (std::size_t m = 0; m < base_ && pending != 0; ++m) {
+            if (m != n && workers_[m]->parked.load(std::memory_order_relaxed)) {
+                Wake(m);
+                --pending;
+            }
+        }
+
+        Grow();
+    }
+
+    void Unblock(std::size_t n) noexcept
+    {
+        workers_[n]->blocked.store(false, std::memory_order_relaxed);
+        blocked_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // index % base_, which a fixed worker count turns into a mask or a division by a constant
+    std::size_t Wrap(std::size_t index) const noexcept
+    {
+        if constexpr (kFixed && std::has_single_bit(N))
+            return index & (N - 1);
+        else if constexpr (kFixed)
+            return index % N;
+        else
+            return index % base_;
+    }
+
+    // index % count_, the same as Wrap() unless extra workers may run
+    std::size_t WrapAll(std::size_t index) const noexcept
+    {
+        if constexpr (kFixed)
+            return Wrap(index);
+        else
+            return index % count_;
+    }
+
+    // Nothing starts a thread once stopping is set
+    void StartWorkers()
+    {
+        std::lock_guard lock { elastic_.mutex };
+
+        if (started_.load(std::memory_order_relaxed) || elastic_.stopping || !elastic_.run)
+            return;
+
+        for (std::size_t n = 0; n < base_; ++n)
+            elastic_.threads[n] = Spawn(elastic_.run, n);
+
+        started_.store(true, std::memory_order_relaxed);
+    }
+
+    void JoinWorkers()
+    {
+        for (auto& thread : elastic_.threads) {
+            if (thread.valid())
+                thread.get();
+        }
+    }
+
+    // Everything counted in, nudges included, is either done or dropped, evictions of the queues included
+    //
+    // What went out is read before what came in, so that no item is seen out without being seen in.
+    bool Idle() const
+    {
+        std::size_t out = 0;
+        std::size_t in = 0;
+
+        for (const auto& worker : workers_)
+            out += worker->done.load(std::memory_order_acquire) + worker->queue.Dropped() + worker->keyed.Dropped();
+
+        out += dropped_.load(std::memory_order_acquire);
+        in = posted_.load(std::memory_order_acquire);
+
+        for (const auto& worker : workers_)
+            in += worker->spawned.load(std::memory_order_acquire);
+
+        return out == in;
+    }
+
+    void Drop(std::size_t count)
+    {
+        dropped_.fetch_add(count, std::memory_order_release);
+        quiet_.Notify();
+    }
+
+    // Pulls a batch out of the own inbox into the deque, so that thieves don't contend for the inbox
+    std::optional<Item<T>> Refill(std::size_t n)
+    {
+        auto value = workers_[n]->queue.TryPop();
+
+        // Lanes and bounds only hold in the inbox
+        if (kPrioritized || options_.bound.capacity != 0)
+            return value;
+
+        if (value) {
+            for (std::size_t count = 1; count < kRefillSize; ++count) {
+                auto next = workers_[n]->queue.TryPop();
+
+                if (!next)
+                    break;
+                else if (!workers_[n]->deque.TryEmplace(*std::move(next))) {
+                    if (!workers_[n]->queue.Emplace(*std::move(next)))
+                        Drop(1);
+
+                    break;
+                }
+            }
+        }
+
+        return value;
+    }
+
+    std::optional<Item<T>> Steal(std::size_t n, std::minstd_rand& random)
+    {
+        std::optional<Item<T>> value;
+
+        if (count_ == 1)
+            return value;
+
+        // Random victim order so that idle workers don't hit the same neighbours at once
+        const auto start = WrapAll(random());
+
+        workers_[n]->stats.StealAttempt();
+
+        for (std::size_t offset = 0; offset < count_ && !value; ++offset) {
+            const auto victim = WrapAll(start + offset);
+
+            if (victim == n)
+                continue;
+
+            // Empty() is lock-free, so it's cheap to skip idle victims
+            if (!workers_[victim]->deque.Empty())
+                value = workers_[victim]->deque.Steal();
+
+            if (!value && !workers_[victim]->queue.Empty())
+                value = workers_[victim]->queue.TryPop();
+
+            if (value && value->GetJob() == &nudge_) {
+                value.reset();
+                Bump(workers_[n]->done);
+                Wake(victim);
+            }
+
+            if (value)
+                workers_[n]->trace.Take(victim);
+        }
+
+        if (value)
+            workers_[n]->stats.Stolen();
+
+        return value;
+    }
+
+    // Runs pop(), which blocks on the inbox, unless a keyed item came in meanwhile. Returns false once stopped.
+    template <typename Pop>
+    bool Park(std::size_t n, Pop pop)
+    {
+        auto& worker = *workers_[n];
+        auto running = true;
+
+        if (n >= base_)
+            return Rest(n);
+
+        // Pairs with the fence in Wake(), so that either PostKeyed() sees parked or this sees the keyed item
+        worker.parked.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (worker.keyed.Empty()) {
+            worker.stats.Parked();
+            running = pop();
+        }
+
+        worker.parked.store(false, std::memory_order_relaxed);
+
+        return running;
+    }
+
+    // Pushes the nudge into a parked owner's inbox, which isn't full if the owner sleeps on it
+    void Wake(std::size_t n)
+    {
+        auto& worker = *workers_[n];
+        Job* nudge = &nudge_;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!worker.parked.load(std::memory_order_relaxed))
+            return;
+
+        posted_.fetch_add(1, std::memory_order_relaxed);
+
+        if (!worker.queue.TryEmplace(nudge) && !worker.queue.Offer(nudge))
+            Drop(1);
+    }
+
+    // Calls for another worker if worker's inbox is getting long
+    void Demand(const Worker& worker)
+    {
+        if constexpr (!kGrows<Policy>)
+            return;
+
+        if (count_ != base_ && worker.queue.Size() >= options_.elastic.depth)
+            Grow();
+    }
+
+    // Wakes up a resting extra worker, or starts one in a spare slot
+    void Grow()
+    {
+        if constexpr (!kGrows<Policy>)
+            return;
+
+        if (elastic_.resting.load(std::memory_order_relaxed) == 0 && elastic_.spares.load(std::memory_order_relaxed) == 0)
+            return;
+
+        std::unique_lock lock { elastic_.mutex, std::try_to_lock };
+
+        if (!lock || elastic_.stopping)
+            return;
+
+        if (elastic_.resting.load(std::memory_order_relaxed) > elastic_.wakeups) {
+            ++elastic_.wakeups;
+            lock.unlock();
+            elastic_.cv.notify_one();
+            return;
+        }
+
+        if (elastic_.spare.empty())
+            return;
+
+        const auto n = elastic_.spare.back();
+
+        elastic_.spare.pop_back();
+        elastic_.spares.store(elastic_.spare.size(), std::memory_order_relaxed);
+
+        // A retired thread is done with the lock once its slot is spare, so this only waits for it to return
+        if (elastic_.threads[n].valid())
+            elastic_.threads[n].get();
+
+        elastic_.threads[n] = Spawn(elastic_.run, n);
+    }
+
+    // Where extra workers wait for Grow(), false once they retire or the Tasker stops
+    bool Rest(std::size_t n)
+    {
+        std::unique_lock lock { elastic_.mutex };
+
+        if (elastic_.stopping)
+            return false;
+
+        workers_[n]->stats.Parked();
+        elastic_.resting.fetch_add(1, std::memory_order_relaxed);
+
+        const auto woken = elastic_.cv.wait_for(lock, options_.elastic.idle, [&] { return elastic_.stopping || elastic_.wakeups != 0; });
+
+        elastic_.resting.fetch_sub(1, std::memory_order_relaxed);
+
+        if (woken && !elastic_.stopping) {
+            --elastic_.wakeups;
+            return true;
+        }
+
+        if (!elastic_.stopping) {
+            elastic_.spare.push_back(n);
+            elastic_.spares.store(elastic_.spare.size(), std::memory_order_relaxed);
+        }
+
+        return false;
+    }
+
+    // Keeps looking for work as long as the WaitPolicy allows before the caller parks on its inbox
+    std::optional<Item<T>> Spin(std::size_t n, std::minstd_rand& random)
+    {
+        std::optional<Item<T>> value;
+
+        SpinWait(WaitOf<Policy>(options_), [&] {
+            if (!workers_[n]->keyed.Empty())
+                value = workers_[n]->keyed.TryPop();
+            else
+                value = !workers_[n]->queue.Empty() ? Refill(n) : Steal(n, random);
+
+            return value.has_value();
+        });
+
+        return value;
+    }
+
+    struct ElasticState {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::function<void(std::size_t)> run;
+        std::vector<std::future<void>> threads; // Indexed by worker
+        std::vector<std::size_t> spare; // Extra worker slots without a thread
+        std::size_t wakeups { 0 };
+        bool stopping { false };
+        std::atomic_size_t resting { 0 };
+        std::atomic_size_t spares { 0 };
+    };
+
+    ElasticState elastic_;
+
+    static inline thread_local Current current_;
+    static inline thread_local Producer producer_;
+    static inline Nudge nudge_;
+};
+
+} // namespace detail
+
+// Marks a stretch of a callable that blocks, on I/O say, for the Tasker running it
+//
+// For as long as it lives, posts skip the worker and parked workers wake up to steal what it holds. With
+// Elastic::max above N, an extra worker is woken or started as well, which stands in until it retires.
+// Keyed items stay with their worker. Outside of a multi-worker Tasker it does nothing.
+class BlockingScope {
+public:
+    BlockingScope()
+    {
+        auto& hook = detail::blocking_hook;
+
+        if (hook.owner && hook.depth++ == 0)
+            hook.enter(hook.owner, hook.index);
+    }
+
+    ~BlockingScope()
+    {
+        auto& hook = detail::blocking_hook;
+
+        if (hook.owner && --hook.depth == 0)
+            hook.leave(hook.owner, hook.index);
+    }
+
+    BlockingScope(const BlockingScope&) = delete;
+    BlockingScope& operator=(const BlockingScope&) = delete;
+};
+
+template <typename T, std::size_t N = 0, typename Queue = ConcurrentQueue<T>, typename Policy = Dynamic>
+class Tasker : public detail::TaskerCore<T, N, Queue, Policy> {
+    using Core = detail::TaskerCore<T, N, Queue, Policy>;
+
+public:
+    template <typename Function>
+    Tasker(Function function, TaskerOptions options = {})
+        : Core { options }
+    {
+        static_assert(std::is_invocable_v<Function, T>);
+
+        this->futures_.template Expect<detail::ResultOf<Function, T>>();
+
+        // Every worker gets its own copy of function
+        this->Launch([this, function](std::size_t n) { Run(function, n); });
+    }
+
+    template <typename Function>
+    Tasker(Batch batch, Function function, TaskerOptions options = {})
+        : Core { options }
+    {
+        static_assert(std::is_invocable_v<Function, std::span<T>>);
+
+        this->futures_.template Expect<void>();
+
+        this->Launch([this, function, size = std::max<std::size_t>(batch.size, 1)](std::size_t n) { RunBatch(function, n, size); });
+    }
+
+    ~Tasker()
+    {
+        Stop();
+    }
+
+    void Stop()
+    {
+        this->Join();
+    }
+
+    // Drains what's queued until timeout, then leaves the rest to out and returns how many items that was
+    template <typename Rep, typename Period, typename OutputIt = detail::Discard>
+    std::size_t StopFor(std::chrono::duration<Rep, Period> timeout, OutputIt out = {})
+    {
+        return this->JoinUntil(std::chrono::steady_clock::now() + timeout, out);
+    }
+
+    // Only lets the workers finish what they're running, everything still queued goes to out
+    //
+    // Returns how many items were left. Their futures are abandoned, or their coroutines destroyed.
+    template <typename OutputIt = detail::Discard>
+    std::size_t Abort(OutputIt out = {})
+    {
+        return this->JoinNow(out);
+    }
+
+    // R is what Function returns, or void to only learn when the item is done
+    template <typename R = void, typename... Args>
+    Future<R> Submit(Args&&... args)
+    {
+        return this->template SubmitAs<R>(std::forward<Args>(args)...);
+    }
+
+private:
+    template <typename Function>
+    void Run(Function function, std::size_t n)
+    {
+        this->Work(n, function);
+    }
+
+    template <typename Function>
+    void RunBatch(Function function, std::size_t n, std::size_t size)
+    {
+        this->WorkBatch(n, size, function);
+    }
+};
+
+template <typename T, typename Queue, typename Policy>
+class Tasker<T, 1, Queue, Policy> {
+    static_assert(std::is_same_v<typename Queue::value_type, T>);
+
+public:
+    template <typename Function>
+    Tasker(Function function, TaskerOptions options = {})
+        : options_ { std::move(options) }
+    {
+        static_assert(std::is_invocable_v<Function, T>);
+
+        futures_.template Expect<detail::ResultOf<Function, T>>();
+        tasker_.Launch([this, function = std::move(function)]() mutable { Run(std::move(function)); }, options_.lazy);
+    }
+
+    template <typename Function>
+    Tasker(Batch batch, Function function, TaskerOptions options = {})
+        : options_ { std::move(options) }
+    {
+        static_assert(std::is_invocable_v<Function, std::span<T>>);
+
+        futures_.template Expect<void>();
+        tasker_.Launch([this, function = std::move(function), size = std::max<std::size_t>(batch.size, 1)]() mutable { RunBatch(std::move(function), size); },
+            options_.lazy);
+    }
+
+    ~Tasker()
+    {
+        Stop();
+    }
+
+    void Stop()
+    {
+        RequestStop();
+        tasker_.Join();
+    }
+
+    // Stops taking items in and returns right away, the worker goes on with what's queued and exits once it's drained
+    void RequestStop()
+    {
+        tasker_.Stop();
+        queue_.Stop();
+
+        // Last, as the timer thread may be blocked posting into a full queue that an aborting worker no longer drains
+        timers_.Stop();
+    }
+
+    // Drains what's queued until timeout, then leaves the rest to out and returns how many items that was
+    template <typename Rep, typename Period, typename OutputIt = detail::Discard>
+    std::size_t StopFor(std::chrono::duration<Rep, Period> timeout, OutputIt out = {})
+    {
+        RequestStop();
+
+        if (!tasker_.JoinFor(timeout))
+            aborting_.store(true, std::memory_order_relaxed);
+
+        return Finish(out);
+    }
+
+    // Only lets the worker finish what it's running, everything still queued goes to out
+    //
+    // Returns how many items were left. Their futures are abandoned, or their coroutines destroyed.
+    template <typename OutputIt = detail::Discard>
+    std::size_t Abort(OutputIt out = {})
+    {
+        aborting_.store(true, std::memory_order_relaxed);
+
+        return Finish(out);
+    }
+
+    // Blocks until everything posted so far went through and the worker ran out of work, without polling Size()
+    //
+    // Delayed items only count once they're due. Called from the worker, it would wait for itself.
+    void WaitIdle()
+    {
+        quiet_.Wait([this] { return Idle(); });
+    }
+
+    // False if the worker is still busy once timeout passed
+    template <typename Rep, typename Period>
+    bool WaitIdleFor(std::chrono::duration<Rep, Period> timeout)
+    {
+        return quiet_.WaitUntil(std::chrono::steady_clock::now() + timeout, [this] { return Idle(); });
+    }
+
+    // Loop that the worker handles I/O on between items, with an EventQueue
+    EventLoop& Events()
+        requires requires(Queue& queue) { queue.Events(); }
+    {
+        tasker_.Ready();
+
+        return queue_.Events();
+    }
+
+    // Fails once stopped, or when the Tasker is full and rejects
+    template <typename... Args>
+    bool Post(Args&&... args)
+    {
+        tasker_.Ready();
+
+        return Count([&] { return queue_.Emplace(std::in_place, std::forward<Args>(args)...); });
+    }
+
+    template <typename... Args>
+        requires requires { Queue::kLevels; }
+    bool Post(Priority priority, Args&&... args)
+    {
+        tasker_.Ready();
+
+        return Count([&] { return queue_.Emplace(priority, std::in_place, std::forward<Args>(args)...); });
+    }
+
+    // Like Post but fails instead of blocking when the Tasker is full
+    template <typename... Args>
+    bool TryPost(Args&&... args)
+    {
+        tasker_.Ready();
+
+        return Count([&] { return queue_.Offer(std::in_place, std::forward<Args>(args)...); });
+    }
+
+    template <typename... Args>
+        requires requires { Queue::kLevels; }
+    bool TryPost(Priority priority, Args&&... args)
+    {
+        tasker_.Ready();
+
+        return Count([&] { return queue_.Offer(priority, std::in_place, std::forward<Args>(args)...); });
+    }
+
+    // A single worker keeps every key in order anyway
+    template <typename Key, typename... Args>
+    bool PostKeyed(const Key&, Args&&... args)
+    {
+        return Post(std::forward<Args>(args)...);
+    }
+
+    // Posts the item once delay has passed, from a timer thread that starts with the first delayed item
+    template <typename Rep, typename Period, typename... Args>
+    Timer PostAfter(std::chrono::duration<Rep, Period> delay, Args&&... args)
+    {
+        return PostAt(std::chrono::steady_clock::now() + delay, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    Timer PostAt(std::chrono::steady_clock::time_point due, Args&&... args)
+    {
+        static_assert(!detail::SingleProducer<Queue>, "The timer thread would be a second producer");
+
+        return timers_.Schedule(due, {}, T(std::forward<Args>(args)...));
+    }
+
+    // Posts a copy of the item every period, starting one period from now
+    template <typename Rep, typename Period, typename... Args>
+        requires(std::is_copy_constructible_v<T>)
+    Timer PostEvery(std::chrono::duration<Rep, Period> period, Args&&... args)
+    {
+        static_assert(!detail::SingleProducer<Queue>, "The timer thread would be a second producer");
+
+        const auto every = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+
+        return timers_.Schedule(std::chrono::steady_clock::now() + every, every, T(std::forward<Args>(args)...));
+    }
+
+    // False if the item was already posted or cancelled, a periodic one stops repeating
+    bool Cancel(Timer timer)
+    {
+        return timers_.Cancel(timer);
+    }
+
+    std::size_t Size() const
+    {
+        return queue_.Size();
+    }
+
+    // A single entry for the worker
+    std::vector<WorkerStats> Snapshot() const
+    {
+        std::vector<WorkerStats> snapshot(1);
+
+        snapshot[0].depth = queue_.Size();
+        stats_.Read(snapshot[0]);
+
+        return snapshot;
+    }
+
+    // Latest events of sampled items, sorted by time, empty unless built with TASKER_USE_TRACE
+    std::vector<TraceRecord> Trace() const
+    {
+        std::vector<TraceRecord> records;
+
+        trace_.Read(records);
+        std::ranges::stable_sort(records, {}, &TraceRecord::time);
+
+        return records;
+    }
+
+    // co_await Schedule() resumes the coroutine on the worker
+    auto Schedule() noexcept
+    {
+        return detail::Hop { [this](detail::Job* job) {
+            tasker_.Ready();
+
+            return Count([&] { return queue_.Emplace(job); });
+        } };
+    }
+
+    // Forward iterators, since the whole range is counted in before any of it is pushed
+    template <std::forward_iterator ForwardIt, std::sentinel_for<ForwardIt> Sentinel>
+    std::size_t PostBulk(ForwardIt first, Sentinel last)
+    {
+        const auto size = static_cast<std::size_t>(std::ranges::distance(first, last));
+
+        tasker_.Ready();
+        posted_.fetch_add(size, std::memory_order_relaxed);
+
+        const auto count = queue_.PushBulk(first, last);
+
+        stats_.Posted(count);
+
+        if (count != size)
+            Drop(size - count);
+
+        return count;
+    }
+
+    template <std::ranges::forward_range Range>
+    std::size_t PostRange(Range&& range)
+    {
+        return PostBulk(std::ranges::begin(range), std::ranges::end(range));
+    }
+
+    void Clear()
+    {
+        const auto count = queue_.Clear();
+
+        if (count != 0)
+            Drop(count);
+    }
+
+    // R is what Function returns, or void to only learn when the item is done
+    template <typename R = void, typename... Args>
+    Future<R> Submit(Args&&... args)
+    {
+        detail::Item<T> item { std::in_place, std::forward<Args>(args)... };
+        auto* state = futures_.template Make<R>();
+        auto future = detail::MakeFuture(state);
+
+        // Left in item if the Tasker is stopped, which abandons it
+        item.Attach(state);
+        tasker_.Ready();
+        Count([&] { return queue_.Push(std::move(item)); });
+
+        return future;
+    }
+
+private:
+    // Counted in before the push, so that the worker never finishes an item that isn't counted yet
+    template <typename Push>
+    bool Count(Push push)
+    {
+        auto pushed = false;
+
+        posted_.fetch_add(1, std::memory_order_relaxed);
+
+        try {
+            pushed = push();
+        } catch (...) {
+            Drop(1);
+            throw;
+        }
+
+        if (pushed)
+            stats_.Posted();
+        else
+            Drop(1);
+
+        return pushed;
+    }
+
+    void Drop(std::size_t count)
+    {
+        dropped_.fetch_add(count, std::memory_order_release);
+        quiet_.Notify();
+    }
+
+    // Everything counted in is either done or dropped, by the Tasker or by the queue making room
+    //
+    // What went out is read before what came in, so that no item is seen out without being seen in.
+    bool Idle() const
+    {
+        const auto out = done_.load(std::memory_order_acquire) + dropped_.load(std::memory_order_acquire) + queue_.Dropped();
+
+        return out == posted_.load(std::memory_order_acquire);
+    }
+
+    // Hands what the worker left over to out once it's gone
+    template <typename OutputIt>
+    std::size_t Finish(OutputIt& out)
+    {
+        std::size_t count = 0;
+
+        RequestStop();
+        tasker_.Join();
+
+        // A stopped queue only fails to pop while a late Post() holds the lock
+        while (!queue_.Empty()) {
+            if (auto value = queue_.TryPop()) {
+                detail::HandOver(*std::move(value), out);
+                ++count;
+            }
+        }
+
+        Drop(count);
+
+        return count;
+    }
+
+    template <typename Function>
+    void Run(Function function)
+    {
+        detail::Pin(options_.affinity, 0);
+
+        // Where the queue moves each item, the only move on its way to function
+        detail::Item<T> item;
+
+        while (!aborting_.load(std::memory_order_relaxed) && Next(item)) {
+            const auto tag = item.GetTrace();
+
+            stats_.Executed(item.GetStamp());
+            trace_.Start(tag, 0);
+            detail::Execute(std::move(item), function);
+            trace_.Finish(tag, 0);
+            item.Reset();
+            detail::Bump(done_);
+        }
+    }
+
+    template <typename Function>
+    void RunBatch(Function function, std::size_t size)
+    {
+        detail::BatchBuffer<T> items { size, stats_ };
+
+        detail::Pin(options_.affinity, 0);
+
+        // Whatever a batch holds went through once it's flushed
+        while (!aborting_.load(std::memory_order_relaxed) && NextBatch(items, size) != 0) {
+            const auto count = items.Size();
+
+            items.Flush(function);
+            detail::Bump(done_, count);
+        }
+    }
+
+    // Moves the next item into item, false once stopped and drained
+    bool Next(detail::Item<T>& item)
+    {
+        // Also destroys what a Clear() left in a SpscQueue, which has to be counted before WaitIdle() checks
+        if (queue_.TryPop(item))
+            return true;
+
+        quiet_.Notify();
+
+        if (SpinWait(detail::WaitOf<Policy>(options_), [&] { return !queue_.Empty() && queue_.TryPop(item); }))
+            return true;
+
+        stats_.Parked();
+
+        return queue_.Pop(item);
+    }
+
+    std::size_t NextBatch(detail::BatchBuffer<T>& items, std::size_t size)
+    {
+        std::size_t count = 0;
+
+        if ((count = queue_.TryPopBulk(items.Back(), size)) != 0)
+            return count;
+
+        quiet_.Notify();
+
+        if (SpinWait(detail::WaitOf<Policy>(options_), [&] { return !queue_.Empty() && (count = queue_.TryPopBulk(items.Back(), size)) != 0; }))
+            return count;
+
+        stats_.Parked();
+
+        return queue_.PopBulk(items.Back(), size);
+    }
+
+    TaskerOptions options_;
+    detail::FuturePool futures_;
+    [[no_unique_address]] detail::Counters stats_;
+    [[no_unique_address]] detail::Tracer trace_;
+    typename Queue::template rebind<detail::Item<T>> queue_ { options_.bound };
+    detail::Timers<T> timers_ { [this](T&& value) { return Post(std::move(value)); } };
+    alignas(kCacheLineSize) std::atomic_size_t posted_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t done_ { 0 }; // Only bumped by the worker
+    alignas(kCacheLineSize) std::atomic_size_t dropped_ { 0 }; // Posted but cleared, rejected or left over
+    std::atomic_bool aborting_ { false };
+    detail::IdleSignal quiet_;
+    detail::Launcher tasker_;
+};
+
+template <typename Derived, typename T, std::size_t N = 0, typename Queue = ConcurrentQueue<T>, typename Policy = Dynamic>
+class TaskerBase : public detail::TaskerCore<T, N, Queue, Policy> {
+    using Core = detail::TaskerCore<T, N, Queue, Policy>;
+
+public:
+    explicit TaskerBase(TaskerOptions options = {})
+        : Core { options }
+    {
+        static_assert(ProcessesItems());
+
+        Start();
+    }
+
+    explicit TaskerBase(Batch batch, TaskerOptions options = {})
+        : Core { options }
+        , batch_ { std::max<std::size_t>(batch.size, 1) }
+    {
+        static_assert(ProcessesBatches());
+
+        Start();
+    }
+
+    ~TaskerBase() = default;
+    TaskerBase(const TaskerBase&) = delete;
+    TaskerBase& operator=(const TaskerBase&) = delete;
+
+    TaskerBase(TaskerBase&& other) noexcept
+        : Core { other.options_ }
+        , batch_ { other.batch_ }
+    {
+        this->Take(other);
+        other.Stop();
+
+        Start();
+    }
+
+    TaskerBase& operator=(TaskerBase&& other) noexcept
+    {
+        assert(this != &other);
+
+        this->Take(other);
+        other.Stop();
+
+        return *this;
+    }
+
+    void Stop()
+    {
+        this->Join();
+    }
+
+    // Drains what's queued until timeout, then leaves the rest to out and returns how many items that was
+    template <typename Rep, typename Period, typename OutputIt = detail::Discard>
+    std::size_t StopFor(std::chrono::duration<Rep, Period> timeout, OutputIt out = {})
+    {
+        const auto count = this->JoinUntil(std::chrono::steady_clock::now() + timeout, out);
+
+        return count;
+    }
+
+    // Only lets the workers finish what they're running, everything still queued goes to out
+    //
+    // Returns how many items were left. Their futures are abandoned, or their coroutines destroyed.
+    template <typename OutputIt = detail::Discard>
+    std::size_t Abort(OutputIt out = {})
+    {
+        const auto count = this->JoinNow(out);
+
+        return count;
+    }
+
+    // Future of what Derived::Process returns, Future<void> for batches
+    template <typename... Args>
+    auto Submit(Args&&... args)
+    {
+        return this->template SubmitAs<typename detail::ProcessResult<Derived, T>::type>(std::forward<Args>(args)...);
+    }
+
+private:
+    static constexpr bool ProcessesItems()
+    {
+        return requires(Derived& derived, T&& value) { derived.Process(std::move(value)); };
+    }
+
+    static constexpr bool ProcessesBatches()
+    {
+        return requires(Derived& derived, std::span<T> items) { derived.Process(items); };
+    }
+
+    void Start()
+    {
+        if (batch_ != 0)
+            this->futures_.template Expect<void>();
+        else
+            this->futures_.template Expect<typename detail::ProcessResult<Derived, T>::type>();
+
+        if constexpr (ProcessesBatches()) {
+            if (batch_ != 0) {
+                this->Launch([this](std::size_t n) { RunBatch(n); });
+                return;
+            }
+        }
+
+        if constexpr (ProcessesItems())
+            this->Launch([this](std::size_t n) { Run(n); });
+    }
+
+    void Run(std::size_t n)
+    {
+        auto process = [this](T&& value) -> decltype(auto) { return static_cast<Derived*>(this)->Process(std::move(value)); };
+
+        this->Work(n, process);
+    }
+
+    void RunBatch(std::size_t n)
+    {
+        auto process = [this](std::span<T> items) { static_cast<Derived*>(this)->Process(items); };
+
+        this->WorkBatch(n, batch_, process);
+    }
+
+    std::size_t batch_ { 0 };
+};
+
+template <typename Derived, typename T, typename Queue, typename Policy>
+class TaskerBase<Derived, T, 1, Queue, Policy> {
+    static_assert(std::is_same_v<typename Queue::value_type, T>);
+
+public:
+    explicit TaskerBase(TaskerOptions options = {})
+        : options_ { std::move(options) }
+    {
+        static_assert(ProcessesItems());
+
+        Start();
+    }
+
+    explicit TaskerBase(Batch batch, TaskerOptions options = {})
+        : options_ { std::move(options) }
+        , batch_ { std::max<std::size_t>(batch.size, 1) }
+    {
+        static_assert(ProcessesBatches());
+
+        Start();
+    }
+
+    ~TaskerBase() = default;
+    TaskerBase(const TaskerBase&) = delete;
+    TaskerBase& operator=(const TaskerBase&) = delete;
+
+    TaskerBase(TaskerBase&& other) noexcept
+        : options_ { other.options_ }
+        , batch_ { other.batch_ }
+    {
+        Take(other);
+        Start();
+    }
+
+    TaskerBase& operator=(TaskerBase&& other) noexcept
+    {
+        assert(this != &other);
+
+        Take(other);
+
+        if (tasker_.Joined())
+            Start();
+        else if (!queue_.Empty())
+            tasker_.Ready();
+
+        return *this;
+    }
+
+    void Stop()
+    {
+        RequestStop();
+        tasker_.Join();
+    }
+
+    // Stops taking items in and returns right away, the worker goes on with what's queued and exits once it's drained
+    void RequestStop()
+    {
+        tasker_.Stop();
+        queue_.Stop();
+
+        // Last, as the timer thread may be blocked posting into a full queue that an aborting worker no longer drains
+        timers_.Stop();
+    }
+
+    // Drains what's queued until timeout, then leaves the rest to out and returns how many items that was
+    template <typename Rep, typename Period, typename OutputIt = detail::Discard>
+    std::size_t StopFor(std::chrono::duration<Rep, Period> timeout, OutputIt out = {})
+    {
+        RequestStop();
+
+        if (!tasker_.JoinFor(timeout))
+            aborting_.store(true, std::memory_order_relaxed);
+
+        return Finish(out);
+    }
+
+    // Only lets the worker finish what it's running, everything still queued goes to out
+    //
+    // Returns how many items were left. Their futures are abandoned, or their coroutines destroyed.
+    template <typename OutputIt = detail::Discard>
+    std::size_t Abort(OutputIt out = {})
+    {
+        aborting_.store(true, std::memory_order_relaxed);
+
+        return Finish(out);
+    }
+
+    // Blocks until everything posted so far went through and the worker ran out of work, without polling Size()
+    //
+    // Delayed items only count once they're due. Called from the worker, it would wait for itself.
+    void WaitIdle()
+    {
+        quiet_.Wait([this] { return Idle(); });
+    }
+
+    // False if the worker is still busy once timeout passed
+    template <typename Rep, typename Period>
+    bool WaitIdleFor(std::chrono::duration<Rep, Period> timeout)
+    {
+        return quiet_.WaitUntil(std::chrono::steady_clock::now() + timeout, [this] { return Idle(); });
+    }
 
-template <typename T, std::size_t N = 0>
-class Tasker {
-public:
-    template <typename Function>
-    Tasker(Function function)
+    // Loop that the worker handles I/O on between items, with an EventQueue
+    EventLoop& Events()
+        requires requires(Queue& queue) { queue.Events(); }
     {
-        static_assert(std::is_invocable_v<Function, T>);
+        tasker_.Ready();
 
-        taskers_.reserve(count_);
-        for (std::size_t n = 0; n < count_; ++n)
-            taskers_.emplace_back(std::async(std::launch::async, &Tasker::Run<Function>, this, function, n));
+        return queue_.Events();
     }
 
-    ~Tasker()
+    // Fails once stopped, or when the Tasker is full and rejects
+    template <typename... Args>
+    bool Post(Args&&... args)
     {
-        Stop();
+        tasker_.Ready();
+
+        return Count([&] { return queue_.Emplace(std::in_place, std::forward<Args>(args)...); });
     }
 
-    void Stop()
+    template <typename... Args>
+        requires requires { Queue::kLevels; }
+    bool Post(Priority priority, Args&&... args)
     {
-        for (auto& queue : queues_)
-            queue.Stop();
+        tasker_.Ready();
 
-        for (auto& tasker : taskers_) {
-            if (tasker.valid())
-                tasker.get();
-        }
+        return Count([&] { return queue_.Emplace(priority, std::in_place, std::forward<Args>(args)...); });
+    }
+
+    // Like Post but fails instead of blocking when the Tasker is full
+    template <typename... Args>
+    bool TryPost(Args&&... args)
+    {
+        tasker_.Ready();
 
-        queues_.clear();
-        taskers_.clear();
+        return Count([&] { return queue_.Offer(std::in_place, std::forward<Args>(args)...); });
     }
 
     template <typename... Args>
-    void Post(Args&&... args)
+        requires requires { Queue::kLevels; }
+    bool TryPost(Priority priority, Args&&... args)
     {
-        auto index = index_.fetch_add(1, std::memory_order_relaxed);
+        tasker_.Ready();
 
-        // Schedule task
-        for (std::size_t n = 0; n < count_; ++n) {
-            if (queues_[(index + n) % count_].TryEmplace(std::forward<Args>(args)...))
-                return;
-        }
+        return Count([&] { return queue_.Offer(priority, std::in_place, std::forward<Args>(args)...); });
+    }
 
-        queues_[index % count_].Emplace(std::forward<Args>(args)...);
+    // A single worker keeps every key in order anyway
+    template <typename Key, typename... Args>
+    bool PostKeyed(const Key&, Args&&... args)
+    {
+        return Post(std::forward<Args>(args)...);
     }
 
-    void Clear()
+    // Posts the item once delay has passed, from a timer thread that starts with the first delayed item
+    template <typename Rep, typename Period, typename... Args>
+    Timer PostAfter(std::chrono::duration<Rep, Period> delay, Args&&... args)
     {
-        for (auto& queue : queues_)
-            queue.Clear();
+        return PostAt(std::chrono::steady_clock::now() + delay, std::forward<Args>(args)...);
     }
 
-private:
-    template <typename Function>
-    void Run(Function function, std::size_t n)
+    template <typename... Args>
+    Timer PostAt(std::chrono::steady_clock::time_point due, Args&&... args)
     {
-        auto& queue = queues_[n];
-        std::vector<std::size_t> indices(count_);
+        static_assert(!detail::SingleProducer<Queue>, "The timer thread would be a second producer");
 
-        std::generate(std::begin(indices), std::end(indices), [n, size = count_]() mutable { return n++ % size; });
+        return timers_.Schedule(due, {}, T(std::forward<Args>(args)...));
+    }
 
-        while (true) {
-            std::optional<T> value;
+    // Posts a copy of the item every period, starting one period from now
+    template <typename Rep, typename Period, typename... Args>
+        requires(std::is_copy_constructible_v<T>)
+    Timer PostEvery(std::chrono::duration<Rep, Period> period, Args&&... args)
+    {
+        static_assert(!detail::SingleProducer<Queue>, "The timer thread would be a second producer");
 
-            // Steal task
-            for (const auto index : indices) {
-                if (value = queues_[index].TryPop(); value)
-                    break;
-            }
+        const auto every = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
 
-            if (!value) {
-                if (value = queue.Pop(); !value)
-                    break;
-            }
+        return timers_.Schedule(std::chrono::steady_clock::now() + every, every, T(std::forward<Args>(args)...));
+    }
 
-            function(*std::move(value));
-        }
+    // False if the item was already posted or cancelled, a periodic one stops repeating
+    bool Cancel(Timer timer)
+    {
+        return timers_.Cancel(timer);
     }
 
-    std::size_t count_ { N != 0 ? N : std::max(1u, std::thread::hardware_concurrency()) };
-    std::atomic_size_t index_ { 0 };
-    std::vector<ConcurrentQueue<T>> queues_ { count_ };
-    std::vector<std::future<void>> taskers_;
-};
+    std::size_t Size() const
+    {
+        return queue_.Size();
+    }
 
-template <typename T>
-class Tasker<T, 1> {
-public:
-    template <typename Function>
-    Tasker(Function function)
-        : tasker_ { std::async(std::launch::async, &Tasker::Run<Function>, this, std::move(function)) }
+    // A single entry for the worker
+    std::vector<WorkerStats> Snapshot() const
     {
-        static_assert(std::is_invocable_v<Function, T>);
+        std::vector<WorkerStats> snapshot(1);
+
+        snapshot[0].depth = queue_.Size();
+        stats_.Read(snapshot[0]);
+
+        return snapshot;
     }
 
-    ~Tasker()
+    // Latest events of sampled items, sorted by time, empty unless built with TASKER_USE_TRACE
+    std::vector<TraceRecord> Trace() const
     {
-        Stop();
+        std::vector<TraceRecord> records;
+
+        trace_.Read(records);
+        std::ranges::stable_sort(records, {}, &TraceRecord::time);
+
+        return records;
     }
 
-    void Stop()
+    // co_await Schedule() resumes the coroutine on the worker
+    auto Schedule() noexcept
     {
-        queue_.Stop();
+        return detail::Hop { [this](detail::Job* job) {
+            tasker_.Ready();
 
-        if (tasker_.valid())
-            tasker_.get();
+            return Count([&] { return queue_.Emplace(job); });
+        } };
     }
 
-    template <typename... Args>
-    void Post(Args&&... args)
+    // Forward iterators, since the whole range is counted in before any of it is pushed
+    template <std::forward_iterator ForwardIt, std::sentinel_for<ForwardIt> Sentinel>
+    std::size_t PostBulk(ForwardIt first, Sentinel last)
+    {
+        const auto size = static_cast<std::size_t>(std::ranges::distance(first, last));
+
+        tasker_.Ready();
+        posted_.fetch_add(size, std::memory_order_relaxed);
+
+        const auto count = queue_.PushBulk(first, last);
+
+        stats_.Posted(count);
+
+        if (count != size)
+            Drop(size - count);
+
+        return count;
+    }
+
+    template <std::ranges::forward_range Range>
+    std::size_t PostRange(Range&& range)
     {
-        queue_.Emplace(std::forward<Args>(args)...);
+        return PostBulk(std::ranges::begin(range), std::ranges::end(range));
     }
 
     void Clear()
     {
-        queue_.Clear();
+        const auto count = queue_.Clear();
+
+        if (count != 0)
+            Drop(count);
     }
 
-private:
-    template <typename Function>
-    void Run(Function function)
+    // Future of what Derived::Process returns, Future<void> for batches
+    template <typename... Args>
+    auto Submit(Args&&... args)
     {
-        while (auto value = queue_.Pop())
-            function(*std::move(value));
+        using R = typename detail::ProcessResult<Derived, T>::type;
+
+        detail::Item<T> item { std::in_place, std::forward<Args>(args)... };
+        auto* state = futures_.template Make<R>();
+        auto future = detail::MakeFuture(state);
+
+        // Left in item if the Tasker is stopped, which abandons it
+        item.Attach(state);
+        tasker_.Ready();
+        Count([&] { return queue_.Push(std::move(item)); });
+
+        return future;
     }
 
-    ConcurrentQueue<T> queue_;
-    std::future<void> tasker_;
-};
+private:
+    // Counted in before the push, so that the worker never finishes an item that isn't counted yet
+    template <typename Push>
+    bool Count(Push push)
+    {
+        auto pushed = false;
 
-template <typename Derived, typename T, std::size_t N = 0>
-class TaskerBase {
-public:
-    TaskerBase()
+        posted_.fetch_add(1, std::memory_order_relaxed);
+
+        try {
+            pushed = push();
+        } catch (...) {
+            Drop(1);
+            throw;
+        }
+
+        if (pushed)
+            stats_.Posted();
+        else
+            Drop(1);
+
+        return pushed;
+    }
+
+    void Drop(std::size_t count)
     {
-        taskers_.reserve(count_);
-        for (std::size_t n = 0; n < count_; ++n)
-            taskers_.emplace_back(std::async(std::launch::async, &TaskerBase::Run, this, n));
+        dropped_.fetch_add(count, std::memory_order_release);
+        quiet_.Notify();
     }
 
-    ~TaskerBase() = default;
-    TaskerBase(const TaskerBase&) = delete;
-    TaskerBase& operator=(const TaskerBase&) = delete;
+    // Everything counted in is either done or dropped, by the Tasker or by the queue making room
+    //
+    // What went out is read before what came in, so that no item is seen out without being seen in.
+    bool Idle() const
+    {
+        const auto out = done_.load(std::memory_order_acquire) + dropped_.load(std::memory_order_acquire) + queue_.Dropped();
 
-    TaskerBase(TaskerBase&& other) noexcept
+        return out == posted_.load(std::memory_order_acquire);
+    }
+
+    // Hands what the worker left over to out once it's gone
+    template <typename OutputIt>
+    std::size_t Finish(OutputIt& out)
     {
-        for (std::size_t n = 0; n < count_; ++n)
-            queues_[n] = std::move(other.queues_[n]);
+        std::size_t count = 0;
 
-        other.Stop();
+        RequestStop();
+        tasker_.Join();
 
-        taskers_.reserve(count_);
-        for (std::size_t n = 0; n < count_; ++n)
-            taskers_.emplace_back(std::async(std::launch::async, &TaskerBase::Run, this, n));
+        // A stopped queue only fails to pop while a late Post() holds the lock
+        while (!queue_.Empty()) {
+            if (auto value = queue_.TryPop()) {
+                detail::HandOver(*std::move(value), out);
+                ++count;
+            }
+        }
+
+        Drop(count);
+
+        return count;
     }
 
-    TaskerBase& operator=(TaskerBase&& other) noexcept
+    // Takes over what other still has queued once its worker is gone, the queue may not have a second consumer
+    void Take(TaskerBase& other)
     {
-        assert(this != &other);
+        other.aborting_.store(true, std::memory_order_relaxed);
+        other.RequestStop();
+        other.tasker_.Join();
 
-        for (std::size_t n = 0; n < count_; ++n)
-            queues_[n] = std::move(other.queues_[n]);
+        const auto count = other.queue_.Size();
 
-        other.Stop();
+        // What this still had is replaced, and what it takes over is counted in before its worker can finish any of it
+        Drop(queue_.Clear());
+        posted_.fetch_add(count, std::memory_order_relaxed);
+        queue_ = std::move(other.queue_);
+        other.Drop(count);
+    }
+
+    static constexpr bool ProcessesItems()
+    {
+        return requires(Derived& derived, T&& value) { derived.Process(std::move(value)); };
+    }
+
+    static constexpr bool ProcessesBatches()
+    {
+        return requires(Derived& derived, std::span<T> items) { derived.Process(items); };
+    }
 
-        if (taskers_.empty()) {
-            taskers_.reserve(count_);
-            for (std::size_t n = 0; n < count_; ++n)
-                taskers_.emplace_back(std::async(std::launch::async, &TaskerBase::Run, this, n));
+    void Start()
+    {
+        if (batch_ != 0)
+            futures_.template Expect<void>();
+        else
+            futures_.template Expect<typename detail::ProcessResult<Derived, T>::type>();
+
+        if constexpr (ProcessesBatches()) {
+            if (batch_ != 0) {
+                tasker_.Launch([this] { RunBatch(); }, options_.lazy && queue_.Empty());
+                return;
+            }
         }
 
-        return *this;
+        if constexpr (ProcessesItems())
+            tasker_.Launch([this] { Run(); }, options_.lazy && queue_.Empty());
     }
 
-    void Stop()
+    void Run()
     {
-        for (auto& queue : queues_)
-            queue.Stop();
+        auto process = [this](T&& value) -> decltype(auto) { return static_cast<Derived*>(this)->Process(std::move(value)); };
 
-        for (auto& tasker : taskers_) {
-            if (tasker.valid())
-                tasker.get();
+        detail::Pin(options_.affinity, 0);
+
+        // Where the queue moves each item, the only move on its way to process
+        detail::Item<T> item;
+
+        while (!aborting_.load(std::memory_order_relaxed) && Next(item)) {
+            const auto tag = item.GetTrace();
+
+            stats_.Executed(item.GetStamp());
+            trace_.Start(tag, 0);
+            detail::Execute(std::move(item), process);
+            trace_.Finish(tag, 0);
+            item.Reset();
+            detail::Bump(done_);
         }
     }
 
-    template <typename... Args>
-    void Post(Args&&... args)
+    void RunBatch()
     {
-        auto index = index_.fetch_add(1, std::memory_order_relaxed);
+        auto process = [this](std::span<T> items) { static_cast<Derived*>(this)->Process(items); };
+        detail::BatchBuffer<T> items { batch_, stats_ };
 
-        // Schedule task
-        for (std::size_t n = 0; n < count_; ++n) {
-            if (queues_[(index + n) % count_].TryEmplace(std::forward<Args>(args)...))
-                return;
-        }
+        detail::Pin(options_.affinity, 0);
+
+        // Whatever a batch holds went through once it's flushed
+        while (!aborting_.load(std::memory_order_relaxed) && NextBatch(items) != 0) {
+            const auto count = items.Size();
 
-        queues_[index % count_].Emplace(std::forward<Args>(args)...);
+            items.Flush(process);
+            detail::Bump(done_, count);
+        }
     }
 
-    void Clear()
+    // Moves the next item into item, false once stopped and drained
+    bool Next(detail::Item<T>& item)
     {
-        for (auto& queue : queues_)
-            queue.Clear();
+        // Also destroys what a Clear() left in a SpscQueue, which has to be counted before WaitIdle() checks
+        if (queue_.TryPop(item))
+            return true;
+
+        quiet_.Notify();
+
+        if (SpinWait(detail::WaitOf<Policy>(options_), [&] { return !queue_.Empty() && queue_.TryPop(item); }))
+            return true;
+
+        stats_.Parked();
+
+        return queue_.Pop(item);
     }
 
-private:
-    void Run(std::size_t n)
+    std::size_t NextBatch(detail::BatchBuffer<T>& items)
     {
-        auto& queue = queues_[n];
-        std::vector<std::size_t> indices(count_);
+        std::size_t count = 0;
 
-        std::generate(std::begin(indices), std::end(indices), [n, size = count_]() mutable { return n++ % size; });
+        if ((count = queue_.TryPopBulk(items.Back(), batch_)) != 0)
+            return count;
 
-        while (true) {
-            std::optional<T> value;
+        quiet_.Notify();
 
-            // Steal task
-            for (const auto index : indices) {
-                if (value = queues_[index].TryPop(); value)
-                    break;
-            }
+        if (SpinWait(detail::WaitOf<Policy>(options_), [&] { return !queue_.Empty() && (count = queue_.TryPopBulk(items.Back(), batch_)) != 0; }))
+            return count;
 
-            if (!value) {
-                if (value = queue.Pop(); !value)
-                    break;
-            }
+        stats_.Parked();
 
-            static_cast<Derived*>(this)->Process(*std::move(value));
-        }
+        return queue_.PopBulk(items.Back(), batch_);
     }
 
-    std::size_t count_ { N != 0 ? N : std::max(1u, std::thread::hardware_concurrency()) };
-    std::atomic_size_t index_ { 0 };
-    std::vector<ConcurrentQueue<T>> queues_ { count_ };
-    std::vector<std::future<void>> taskers_;
+    TaskerOptions options_;
+    std::size_t batch_ { 0 };
+    detail::FuturePool futures_;
+    [[no_unique_address]] detail::Counters stats_;
+    [[no_unique_address]] detail::Tracer trace_;
+    typename Queue::template rebind<detail::Item<T>> queue_ { options_.bound };
+    detail::Timers<T> timers_ { [this](T&& value) { return Post(std::move(value)); } };
+    alignas(kCacheLineSize) std::atomic_size_t posted_ { 0 };
+    alignas(kCacheLineSize) std::atomic_size_t done_ { 0 }; // Only bumped by the worker
+    alignas(kCacheLineSize) std::atomic_size_t dropped_ { 0 }; // Posted but cleared, rejected or left over
+    std::atomic_bool aborting_ { false };
+    detail::IdleSignal quiet_;
+    detail::Launcher tasker_;
 };
 
-template <typename Derived, typename T>
-class TaskerBase<Derived, T, 1> {
+// Tasker running the tasks it's given, each one stored in its queue slot as is
+//
+// Post(callable) constructs the Task right in the queue, Submit(callable) reports when it's done.
+template <std::size_t N = 0, typename T = Task, typename Queue = ConcurrentQueue<T>, typename Policy = Dynamic>
+class Executor : public Tasker<T, N, Queue, Policy> {
 public:
-    TaskerBase()
-        : tasker_ { std::async(std::launch::async, &TaskerBase::Run, this) }
+    // Grains per worker when ParallelFor() or ParallelReduce() pick one
+    static constexpr std::size_t kGrainsPerWorker = 8;
+
+    explicit Executor(TaskerOptions options = {})
+        : Tasker<T, N, Queue, Policy> { [](T&& task) { task(); }, std::move(options) }
     {
     }
 
-    ~TaskerBase() = default;
-    TaskerBase(const TaskerBase&) = delete;
-    TaskerBase& operator=(const TaskerBase&) = delete;
+    // Calls function on every element of range, on the workers and the calling thread, and returns once all went through
+    //
+    // The caller starts with the whole range and only splits halves off for idle workers, never below grain elements,
+    // so a busy Executor runs it in a few large chunks. The first exception stops the loop and is rethrown here.
+    template <std::ranges::random_access_range Range, typename Function>
+        requires(N != 1)
+    void ParallelFor(Range&& range, Function function, std::size_t grain = 0)
+    {
+        using Body = detail::ForEach<std::ranges::iterator_t<Range>, Function>;
 
-    TaskerBase(TaskerBase&& other) noexcept
+        Split<Body>(std::ranges::size(range), grain, std::ranges::begin(range), function);
+    }
+
+    // Folds transform(element) into init with reduce, which has to be associative and commutative as in std::reduce()
+    template <std::ranges::random_access_range Range, typename U, typename Reduce, typename Transform = std::identity>
+        requires(N != 1)
+    U ParallelReduce(Range&& range, U init, Reduce reduce, Transform transform = {}, std::size_t grain = 0)
     {
-        queue_ = std::move(other.queue_);
-        other.Stop();
+        using Body = detail::Reduction<std::ranges::iterator_t<Range>, U, Reduce, Transform>;
 
-        tasker_ = std::async(std::launch::async, &TaskerBase::Run, this);
+        return std::move(Split<Body>(std::ranges::size(range), grain, std::ranges::begin(range), reduce, transform, std::move(init))->GetBody().total);
     }
 
-    TaskerBase& operator=(TaskerBase&& other) noexcept
+private:
+    // Runs a Splitter over [0, size) with a Body built from args, returned once every chunk went through
+    template <typename Body, typename... Args>
+    auto Split(std::size_t size, std::size_t grain, Args&&... args)
     {
-        assert(this != &other);
+        auto post = [this](auto&& task) { return this->Post(std::forward<decltype(task)>(task)); };
+        auto hungry = [this] { return this->idle_.load(std::memory_order_relaxed); };
 
-        queue_ = std::move(other.queue_);
-        other.Stop();
+        if (grain == 0)
+            grain = std::max<std::size_t>(size / (this->base_ * kGrainsPerWorker), 1);
 
-        if (!tasker_.valid())
-            tasker_ = std::async(std::launch::async, &TaskerBase::Run, this);
+        auto splitter = std::make_shared<detail::Splitter<Body, decltype(post), decltype(hungry)>>(size, grain, post, hungry, std::forward<Args>(args)...);
 
-        return *this;
+        splitter->Run();
+
+        return splitter;
+    }
+};
+
+namespace detail {
+
+// Lane over the queue of a PooledTasker, running its items with process
+//
+// An exception that escapes process is kept for Stop() and the lane goes on with the next item,
+// since the worker serving it belongs to the pool.
+template <typename T, typename Inbox, typename Process>
+class PoolLane final : public Lane {
+public:
+    PoolLane(Inbox& queue, Process process, LaneOptions options)
+        : Lane { options }
+        , queue_ { queue }
+        , process_ { std::move(process) }
+    {
+    }
+
+    bool Empty() const override
+    {
+        return queue_.Empty();
+    }
+
+    std::size_t Run(std::size_t max) override
+    {
+        std::size_t count = 0;
+
+        while (count < max) {
+            auto value = queue_.TryPop();
+
+            if (!value)
+                break;
+
+            ++count;
+
+            try {
+                Execute(*std::move(value), process_);
+            } catch (...) {
+                Fail(std::current_exception());
+            }
+        }
+
+        return count;
+    }
+
+private:
+    Inbox& queue_;
+    Process process_;
+};
+
+} // namespace detail
+
+// Tasker without threads of its own, its items are processed by the workers of a WorkerPool
+//
+// Any number of PooledTaskers share one pool, each with its own queue, weight and concurrency limit.
+// Stop() and Clear() only affect this one, and Stop() returns once the pool went through what was posted before.
+template <typename T, typename Queue = ConcurrentQueue<T>>
+class PooledTasker {
+    static_assert(std::is_same_v<typename Queue::value_type, T>);
+    static_assert(!detail::SingleProducer<Queue>, "Pool workers pop from any thread");
+
+public:
+    template <typename Function>
+    PooledTasker(WorkerPool& pool, Function function, LaneOptions options = {})
+        : pool_ { &pool }
+        , queue_ { options.bound }
+        , lane_ { std::make_unique<detail::PoolLane<T, Inbox, Function>>(queue_, std::move(function), options) }
+    {
+        static_assert(std::is_invocable_v<Function, T>);
+
+        futures_.template Expect<detail::ResultOf<Function, T>>();
+        pool_->Attach(*lane_);
+    }
+
+    // Runs on WorkerPool::Default()
+    template <typename Function>
+        requires std::is_invocable_v<Function, T>
+    explicit PooledTasker(Function function, LaneOptions options = {})
+        : PooledTasker { WorkerPool::Default(), std::move(function), options }
+    {
+    }
+
+    ~PooledTasker()
+    {
+        Stop();
     }
 
+    PooledTasker(const PooledTasker&) = delete;
+    PooledTasker& operator=(const PooledTasker&) = delete;
+
+    // Rethrows the first exception of the processing function that didn't go to a Future
     void Stop()
     {
+        if (!lane_)
+            return;
+
+        timers_.Stop();
         queue_.Stop();
 
-        if (tasker_.valid())
-            tasker_.get();
+        // Whatever is left still gets processed by the pool
+        pool_->Notify();
+        lane_->Drain();
+
+        // A worker may have picked the lane up in between, to find nothing
+        pool_->Detach(*lane_);
+        lane_->Quiesce();
+
+        const auto error = lane_->Error();
+
+        lane_.reset();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Fails once stopped, or when the queue is full and rejects
+    template <typename... Args>
+    bool Post(Args&&... args)
+    {
+        return Notify(queue_.Emplace(std::in_place, std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+        requires requires { Queue::kLevels; }
+    bool Post(Priority priority, Args&&... args)
+    {
+        return Notify(queue_.Emplace(priority, std::in_place, std::forward<Args>(args)...));
+    }
+
+    // Like Post but fails instead of blocking when the queue is full
+    template <typename... Args>
+    bool TryPost(Args&&... args)
+    {
+        return Notify(queue_.Offer(std::in_place, std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+        requires requires { Queue::kLevels; }
+    bool TryPost(Priority priority, Args&&... args)
+    {
+        return Notify(queue_.Offer(priority, std::in_place, std::forward<Args>(args)...));
+    }
+
+    template <typename Rep, typename Period, typename... Args>
+    Timer PostAfter(std::chrono::duration<Rep, Period> delay, Args&&... args)
+    {
+        return PostAt(std::chrono::steady_clock::now() + delay, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
-    void Post(Args&&... args)
+    Timer PostAt(std::chrono::steady_clock::time_point due, Args&&... args)
+    {
+        return timers_.Schedule(due, {}, T(std::forward<Args>(args)...));
+    }
+
+    template <typename Rep, typename Period, typename... Args>
+        requires(std::is_copy_constructible_v<T>)
+    Timer PostEvery(std::chrono::duration<Rep, Period> period, Args&&... args)
+    {
+        const auto every = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+
+        return timers_.Schedule(std::chrono::steady_clock::now() + every, every, T(std::forward<Args>(args)...));
+    }
+
+    bool Cancel(Timer timer)
+    {
+        return timers_.Cancel(timer);
+    }
+
+    std::size_t Size() const
+    {
+        return queue_.Size();
+    }
+
+    // co_await Schedule() resumes the coroutine on a worker of the pool
+    auto Schedule() noexcept
+    {
+        return detail::Hop { [this](detail::Job* job) { return Notify(queue_.Emplace(job)); } };
+    }
+
+    template <std::input_iterator InputIt, std::sentinel_for<InputIt> Sentinel>
+    std::size_t PostBulk(InputIt first, Sentinel last)
     {
-        queue_.Emplace(std::forward<Args>(args)...);
+        const auto count = queue_.PushBulk(first, last);
+
+        Notify(count != 0);
+
+        return count;
+    }
+
+    template <std::ranges::input_range Range>
+    std::size_t PostRange(Range&& range)
+    {
+        const auto count = queue_.PushRange(std::forward<Range>(range));
+
+        Notify(count != 0);
+
+        return count;
     }
 
     void Clear()
@@ -299,15 +2927,54 @@ public:
         queue_.Clear();
     }
 
+    // R is what Function returns, or void to only learn when the item is done
+    template <typename R = void, typename... Args>
+    Future<R> Submit(Args&&... args)
+    {
+        detail::Item<T> item { std::in_place, std::forward<Args>(args)... };
+        auto* state = futures_.template Make<R>();
+        auto future = detail::MakeFuture(state);
+
+        // Left in item if the PooledTasker is stopped, which abandons it
+        item.Attach(state);
+        Notify(queue_.Push(std::move(item)));
+
+        return future;
+    }
+
 private:
-    void Run()
+    using Inbox = typename Queue::template rebind<detail::Item<T>>;
+
+    bool Notify(bool posted)
+    {
+        if (posted)
+            pool_->Notify();
+
+        return posted;
+    }
+
+    WorkerPool* pool_;
+    detail::FuturePool futures_;
+    Inbox queue_;
+    std::unique_ptr<detail::Lane> lane_;
+    detail::Timers<T> timers_ { [this](T&& value) { return Post(std::move(value)); } };
+};
+
+// PooledTasker calling Derived::Process(T&&), which has to call Stop() in its destructor
+template <typename Derived, typename T, typename Queue = ConcurrentQueue<T>>
+class PooledTaskerBase : public PooledTasker<T, Queue> {
+public:
+    explicit PooledTaskerBase(WorkerPool& pool = WorkerPool::Default(), LaneOptions options = {})
+        : PooledTasker<T, Queue> { pool, [this](T&& value) { return static_cast<Derived*>(this)->Process(std::move(value)); }, options }
     {
-        while (auto value = queue_.Pop())
-            static_cast<Derived*>(this)->Process(*std::move(value));
     }
 
-    ConcurrentQueue<T> queue_;
-    std::future<void> tasker_;
+    // Deduces the result from Derived::Process
+    template <typename... Args>
+    auto Submit(Args&&... args)
+    {
+        return PooledTasker<T, Queue>::template Submit<typename detail::ProcessResult<Derived, T>::type>(std::forward<Args>(args)...);
+    }
 };
 
-#endif // TASKER_H_
\ No newline at end of file
+#endif // TASKER_H_
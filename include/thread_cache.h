@@ -0,0 +1,134 @@
+#ifndef THREAD_CACHE_H_
+#define THREAD_CACHE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "platform.h"
+#include "task.h"
+
+namespace detail {
+
+// Threads of the whole process that wait for something to run once they're done, like std::async but without
+// creating a thread every time
+//
+// Short-lived Taskers, and Taskers moved into one another, get the threads the previous ones gave back. A thread
+// left without anything to run for kKeepAlive exits. Each run starts with the CPUs of the main thread, whatever
+// pinned the thread that started it or the previous run.
+class ThreadCache {
+public:
+    static constexpr std::chrono::seconds kKeepAlive { 10 };
+
+    // Never destroyed, since cached threads may still wait on it while the process exits
+    static ThreadCache& Instance()
+    {
+        static auto* cache = new ThreadCache;
+
+        return *cache;
+    }
+
+    ThreadCache(const ThreadCache&) = delete;
+    ThreadCache& operator=(const ThreadCache&) = delete;
+
+    // The future is ready once run returned and was destroyed, with what it threw if it did
+    std::future<void> Run(Task run)
+    {
+        std::promise<void> promise;
+        auto future = promise.get_future();
+        std::lock_guard lock { mutex_ };
+
+        // Throws before anything changed if the thread can't be created
+        if (idle_ <= jobs_.size()) {
+            std::thread { [this] { Loop(); } }.detach();
+            ++idle_;
+        }
+
+        jobs_.push_back({ std::move(run), std::move(promise) });
+        cv_.notify_one();
+
+        return future;
+    }
+
+    // Threads waiting for a run, or about to
+    std::size_t Idle() const
+    {
+        std::lock_guard lock { mutex_ };
+
+        return idle_;
+    }
+
+private:
+    struct Job {
+        Task run;
+        std::promise<void> promise;
+    };
+
+    ThreadCache() = default;
+
+    void Loop()
+    {
+        // Started from a pinned worker, the thread would otherwise run everything on that worker's CPUs
+        affinity_.Restore();
+
+        std::unique_lock lock { mutex_ };
+
+        while (cv_.wait_for(lock, kKeepAlive, [this] { return !jobs_.empty(); })) {
+            auto job = std::move(jobs_.front());
+            std::exception_ptr error;
+
+            jobs_.pop_front();
+            --idle_;
+            lock.unlock();
+
+            try {
+                job.run();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            job.run.Reset();
+            affinity_.Restore();
+
+            // Idle again before the future is ready, so that whoever waited for it and runs something next gets this thread
+            lock.lock();
+            ++idle_;
+            lock.unlock();
+
+            if (error)
+                job.promise.set_exception(error);
+            else
+                job.promise.set_value();
+
+            lock.lock();
+        }
+
+        --idle_;
+    }
+
+    const SavedAffinity affinity_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    std::size_t idle_ { 0 };
+};
+
+// Calls function(args...) on a cached thread, for std::async(std::launch::async, function, args...)
+template <typename Function, typename... Args>
+std::future<void> Spawn(Function&& function, Args&&... args)
+{
+    return ThreadCache::Instance().Run([function = std::forward<Function>(function), ... args = std::forward<Args>(args)]() mutable {
+        std::invoke(std::move(function), std::move(args)...);
+    });
+}
+
+} // namespace detail
+
+#endif // THREAD_CACHE_H_
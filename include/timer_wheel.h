@@ -0,0 +1,421 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_cache.h"
+
+// Handle of a scheduled item, a plain index into the wheel that stays valid to cancel until the item is posted
+struct Timer {
+    std::uint32_t index { 0 };
+    std::uint32_t generation { 0 };
+};
+
+// Hierarchical timer wheel holding items of type T, not thread-safe
+//
+// Levels of 256 slots each cover 2^8, 2^16, 2^24 and 2^32 ticks, an item cascades down a level whenever
+// the level below wraps around, and items further out than that wait in the last level to be placed again.
+// Nodes live in one vector with a free list, so Schedule() allocates only while the vector grows,
+// and both Schedule() and Cancel() are O(1).
+template <typename T>
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kSlotBits = 8;
+    static constexpr std::size_t kSlots = 1 << kSlotBits;
+    static constexpr std::size_t kLevels = 4;
+
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds { 1 }, Clock::time_point origin = Clock::now())
+        : tick_ { std::max(tick, Clock::duration { 1 }) }
+        , origin_ { origin }
+    {
+        for (auto& level : heads_)
+            level.fill(kNone);
+    }
+
+    bool Empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    std::size_t Size() const noexcept
+    {
+        return size_;
+    }
+
+    // Periodic items repeat at a fixed rate from due, skipping the periods that have already passed
+    Timer Schedule(Clock::time_point due, Clock::duration period, T value)
+    {
+        assert(period == Clock::duration::zero() || std::is_copy_constructible_v<T>);
+
+        const auto index = Allocate();
+        auto& node = nodes_[index];
+
+        node.value.emplace(std::move(value));
+        node.tick = TickOf(due, true);
+        node.period = period > Clock::duration::zero() ? std::max<std::uint64_t>(TickOf(origin_ + period, true), 1) : 0;
+        Place(index);
+        ++size_;
+
+        return Timer { index, node.generation };
+    }
+
+    // False if the item was already posted or cancelled
+    bool Cancel(Timer timer) noexcept
+    {
+        if (timer.index >= nodes_.size() || nodes_[timer.index].generation != timer.generation || !nodes_[timer.index].value)
+            return false;
+
+        Unlink(timer.index);
+        Free(timer.index);
+        --size_;
+
+        return true;
+    }
+
+    // Moves every item due by now into out, copies of periodic ones
+    template <typename OutputIt>
+    void Advance(Clock::time_point now, OutputIt out)
+    {
+        const auto target = TickOf(now, false);
+
+        while (cursor_ < target) {
+            const auto next = size_ != 0 ? NextTick() : target;
+
+            if (next > target) {
+                cursor_ = target;
+                break;
+            }
+
+            cursor_ = next;
+
+            for (auto level = kLevels - 1; level != 0; --level) {
+                if ((next & ((std::uint64_t { 1 } << (level * kSlotBits)) - 1)) == 0)
+                    Cascade(level, SlotOf(next, level));
+            }
+
+            Expire(SlotOf(next, 0), out);
+        }
+    }
+
+    // When Advance() has something to do next, nullopt if the wheel is empty
+    std::optional<Clock::time_point> Deadline() const
+    {
+        if (size_ == 0)
+            return std::nullopt;
+
+        return origin_ + tick_ * static_cast<Clock::rep>(NextTick());
+    }
+
+private:
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::size_t kWords = kSlots / 64;
+
+    struct Node {
+        std::optional<T> value;
+        std::uint64_t tick { 0 };
+        std::uint64_t period { 0 };
+        std::uint32_t prev { kNone };
+        std::uint32_t next { kNone };
+        std::uint16_t level { 0 };
+        std::uint16_t slot { 0 };
+        std::uint32_t generation { 1 };
+    };
+
+    // Rounded up for due times so that nothing fires early, down for the current time
+    std::uint64_t TickOf(Clock::time_point time, bool up) const noexcept
+    {
+        if (time <= origin_)
+            return 0;
+
+        const auto ticks = (time - origin_) / tick_;
+
+        return static_cast<std::uint64_t>(ticks) + (up && origin_ + tick_ * ticks < time ? 1 : 0);
+    }
+
+    static std::size_t SlotOf(std::uint64_t tick, std::size_t level) noexcept
+    {
+        return static_cast<std::size_t>(tick >> (level * kSlotBits)) & (kSlots - 1);
+    }
+
+    std::uint32_t Allocate()
+    {
+        if (free_ != kNone) {
+            const auto index = free_;
+
+            free_ = nodes_[index].next;
+
+            return index;
+        }
+
+        assert(nodes_.size() < kNone);
+
+        nodes_.emplace_back();
+
+        return static_cast<std::uint32_t>(nodes_.size() - 1);
+    }
+
+    void Free(std::uint32_t index) noexcept
+    {
+        auto& node = nodes_[index];
+
+        node.value.reset();
+        ++node.generation;
+        node.next = free_;
+        free_ = index;
+    }
+
+    // The level is where the tick first differs from the cursor, so every slot an item sits in is still ahead
+    //
+    // Cascading items may land on the cursor itself, in the level 0 slot that's about to expire.
+    void Place(std::uint32_t index, bool cascading = false) noexcept
+    {
+        auto& node = nodes_[index];
+        auto tick = std::max(node.tick, cascading ? cursor_ : cursor_ + 1);
+
+        // Beyond the last level, parked at the end of the current span or, right there, at the start of the next one
+        if (((tick ^ cursor_) >> (kLevels * kSlotBits)) != 0)
+            tick = (cursor_ | kSpan) != cursor_ ? cursor_ | kSpan : cursor_ + 1;
+
+        const auto level = tick != cursor_ ? std::min<std::size_t>((std::bit_width(tick ^ cursor_) - 1) / kSlotBits, kLevels - 1) : 0;
+        const auto slot = SlotOf(tick, level);
+        auto& head = heads_[level][slot];
+
+        node.level = static_cast<std::uint16_t>(level);
+        node.slot = static_cast<std::uint16_t>(slot);
+        node.prev = kNone;
+        node.next = head;
+
+        if (head != kNone)
+            nodes_[head].prev = index;
+
+        head = index;
+        occupied_[level][slot / 64] |= std::uint64_t { 1 } << (slot % 64);
+    }
+
+    void Unlink(std::uint32_t index) noexcept
+    {
+        auto& node = nodes_[index];
+
+        if (node.prev != kNone)
+            nodes_[node.prev].next = node.next;
+        else if ((heads_[node.level][node.slot] = node.next) == kNone)
+            occupied_[node.level][node.slot / 64] &= ~(std::uint64_t { 1 } << (node.slot % 64));
+
+        if (node.next != kNone)
+            nodes_[node.next].prev = node.prev;
+    }
+
+    // Detaches the list of a slot
+    std::uint32_t Take(std::size_t level, std::size_t slot) noexcept
+    {
+        occupied_[level][slot / 64] &= ~(std::uint64_t { 1 } << (slot % 64));
+
+        return std::exchange(heads_[level][slot], kNone);
+    }
+
+    void Cascade(std::size_t level, std::size_t slot) noexcept
+    {
+        for (auto index = Take(level, slot); index != kNone;) {
+            const auto next = nodes_[index].next;
+
+            Place(index, true);
+            index = next;
+        }
+    }
+
+    template <typename OutputIt>
+    void Expire(std::size_t slot, OutputIt& out)
+    {
+        for (auto index = Take(0, slot); index != kNone;) {
+            auto& node = nodes_[index];
+            const auto next = node.next;
+
+            // Parked at the end of a span, still further out
+            if (node.tick > cursor_)
+                Place(index);
+            else if (node.period == 0) {
+                *out++ = *std::move(node.value);
+                Free(index);
+                --size_;
+            } else {
+                if constexpr (std::is_copy_constructible_v<T>)
+                    *out++ = *node.value;
+
+                while (node.tick <= cursor_)
+                    node.tick += node.period;
+
+                Place(index);
+            }
+
+            index = next;
+        }
+    }
+
+    // First tick after the cursor with a slot to look at, the nearest level with an occupied slot ahead being the earliest
+    std::uint64_t NextTick() const noexcept
+    {
+        for (std::size_t level = 0; level < kLevels; ++level) {
+            const auto shift = level * kSlotBits;
+            const auto current = SlotOf(cursor_, level);
+
+            for (auto slot = current + 1; slot < kSlots;) {
+                const auto bits = occupied_[level][slot / 64] >> (slot % 64);
+
+                if (bits != 0) {
+                    slot += static_cast<std::size_t>(std::countr_zero(bits));
+
+                    return ((cursor_ >> (shift + kSlotBits)) << (shift + kSlotBits)) | (std::uint64_t { slot } << shift);
+                }
+
+                slot = (slot / 64 + 1) * 64;
+            }
+        }
+
+        // Only items parked at the end of the span or wrapped into the next one are left
+        return (cursor_ | kSpan) + 1;
+    }
+
+    static constexpr std::uint64_t kSpan = (std::uint64_t { 1 } << (kLevels * kSlotBits)) - 1;
+
+    Clock::duration tick_;
+    Clock::time_point origin_;
+    std::uint64_t cursor_ { 0 };
+    std::size_t size_ { 0 };
+    std::uint32_t free_ { kNone };
+    std::vector<Node> nodes_;
+    std::array<std::array<std::uint32_t, kSlots>, kLevels> heads_;
+    std::array<std::array<std::uint64_t, kWords>, kLevels> occupied_ {};
+};
+
+namespace detail {
+
+// Drives a TimerWheel from a thread of its own that starts with the first item and hands due items to post
+//
+// The thread sleeps until the earliest deadline, and Schedule() only wakes it up for an item due before that.
+template <typename T>
+class Timers {
+public:
+    using Clock = typename TimerWheel<T>::Clock;
+
+    explicit Timers(std::function<bool(T&&)> post)
+        : post_ { std::move(post) }
+    {
+    }
+
+    ~Timers()
+    {
+        Stop();
+    }
+
+    Timers(const Timers&) = delete;
+    Timers& operator=(const Timers&) = delete;
+
+    // An invalid Timer once stopped
+    Timer Schedule(Clock::time_point due, Clock::duration period, T value)
+    {
+        std::unique_lock lock { mutex_ };
+
+        if (done_)
+            return {};
+
+        const auto timer = wheel_.Schedule(due, period, std::move(value));
+
+        if (!thread_.valid()) {
+            thread_ = Spawn(&Timers::Run, this);
+            return timer;
+        }
+
+        const auto notify = wheel_.Deadline() < wake_;
+
+        lock.unlock();
+
+        if (notify)
+            cv_.notify_one();
+
+        return timer;
+    }
+
+    bool Cancel(Timer timer)
+    {
+        std::lock_guard lock { mutex_ };
+
+        return wheel_.Cancel(timer);
+    }
+
+    // Drops pending items
+    void Stop()
+    {
+        {
+            std::lock_guard lock { mutex_ };
+
+            done_ = true;
+            wheel_ = TimerWheel<T> {};
+        }
+
+        cv_.notify_all();
+
+        if (thread_.valid())
+            thread_.get();
+    }
+
+private:
+    void Run()
+    {
+        std::vector<T> due;
+        std::unique_lock lock { mutex_ };
+
+        while (!done_) {
+            wheel_.Advance(Clock::now(), std::back_inserter(due));
+
+            // Posting may block on a bounded Tasker, so it happens outside of the lock
+            if (!due.empty()) {
+                lock.unlock();
+
+                for (auto& value : due)
+                    post_(std::move(value));
+
+                due.clear();
+                lock.lock();
+                continue;
+            }
+
+            const auto deadline = wheel_.Deadline();
+
+            wake_ = deadline.value_or(Clock::time_point::max());
+
+            if (deadline)
+                cv_.wait_until(lock, *deadline);
+            else
+                cv_.wait(lock);
+        }
+    }
+
+    std::function<bool(T&&)> post_;
+    TimerWheel<T> wheel_;
+    Clock::time_point wake_ { Clock::time_point::max() };
+    bool done_ { false };
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::future<void> thread_;
+};
+
+} // namespace detail
+
+#endif // TIMER_WHEEL_H_
@@ -0,0 +1,260 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Step in the life of a traced item
+enum class TraceEvent : std::uint8_t {
+    Posted, // Pushed into a queue, stamped when the item was constructed there
+    Dequeued, // Taken by the worker it was queued on
+    Stolen, // Taken by another worker, from being the victim
+    Started,
+    Finished,
+};
+
+// One event as Tasker::Trace() returns it, times in nanoseconds of steady_clock
+struct TraceRecord {
+    std::uint64_t time { 0 };
+    std::uint64_t id { 0 }; // Same for every event of an item
+    std::uint32_t worker { 0 }; // That recorded it, the one running the item
+    std::uint32_t from { 0 }; // Queue the item was taken from
+    TraceEvent event { TraceEvent::Posted };
+};
+
+// Traces one in every items posted from each thread, 0 to stop tracing, only with TASKER_USE_TRACE
+inline void SetTraceSampling(std::uint32_t every) noexcept;
+
+// Writes records as Chrome trace JSON, which chrome://tracing and Perfetto both open
+//
+// Each worker is a thread, running items are slices and queueing shows as an async slice from posted to taken.
+inline void WriteChromeTrace(std::ostream& out, const std::vector<TraceRecord>& records)
+{
+    auto first = true;
+
+    // Exactly, doubles would round timestamps of a running system to a few microseconds
+    auto Microseconds = [](std::uint64_t time) {
+        auto fraction = std::to_string(time % 1000);
+
+        return std::to_string(time / 1000) + '.' + std::string(3 - fraction.size(), '0') + fraction;
+    };
+
+    auto event = [&](const char* name, char phase, const TraceRecord& record) {
+        out << (first ? "\n" : ",\n") << R"({"name":")" << name << R"(","cat":"tasker","ph":")" << phase
+            << R"(","pid":1,"tid":)" << record.worker << R"(,"ts":)" << Microseconds(record.time)
+            << R"(,"id":)" << record.id << R"(,"args":{"from":)" << record.from << "}}";
+        first = false;
+    };
+
+    out << R"({"traceEvents":[)";
+
+    for (const auto& record : records) {
+        switch (record.event) {
+        case TraceEvent::Posted:
+            event("queued", 'b', record);
+            break;
+        case TraceEvent::Dequeued:
+            event("queued", 'e', record);
+            break;
+        case TraceEvent::Stolen:
+            event("queued", 'e', record);
+            event("stolen", 'i', record);
+            break;
+        case TraceEvent::Started:
+            event("run", 'B', record);
+            break;
+        case TraceEvent::Finished:
+            event("run", 'E', record);
+            break;
+        }
+    }
+
+    out << "\n]}\n";
+}
+
+namespace detail {
+
+#if defined(TASKER_USE_TRACE)
+
+inline std::atomic_uint32_t trace_sampling { 0 };
+inline std::atomic_uint64_t trace_ids { 0 };
+
+inline std::uint64_t TraceNow() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Id and posting time of a sampled item, carried along with it
+class TraceTag {
+public:
+    // Decides whether the item being posted from this thread gets traced, a thread-local countdown keeping it cheap
+    static TraceTag Sample() noexcept
+    {
+        thread_local std::uint32_t countdown = 0;
+
+        const auto every = trace_sampling.load(std::memory_order_relaxed);
+        TraceTag tag;
+
+        if (every == 0)
+            return tag;
+
+        if (countdown == 0 || countdown > every) {
+            countdown = every;
+            tag.id_ = trace_ids.fetch_add(1, std::memory_order_relaxed) + 1;
+            tag.posted_ = TraceNow();
+        }
+
+        --countdown;
+
+        return tag;
+    }
+
+    bool Sampled() const noexcept
+    {
+        return id_ != 0;
+    }
+
+    std::uint64_t Id() const noexcept
+    {
+        return id_;
+    }
+
+    std::uint64_t Posted() const noexcept
+    {
+        return posted_;
+    }
+
+private:
+    std::uint64_t id_ { 0 };
+    std::uint64_t posted_ { 0 };
+};
+
+// Ring of the latest events of one worker, written by that worker only and read by Trace() at any time
+//
+// Fields are relaxed atomics and the reader drops what the writer may have overwritten meanwhile, so neither side waits.
+class Tracer {
+public:
+    static constexpr std::size_t kCapacity = 1 << 12;
+
+    Tracer() = default;
+
+    // The queue items get taken from next, set by whoever takes them, the owner by default
+    void Take(std::size_t from) noexcept
+    {
+        from_ = static_cast<std::uint32_t>(from);
+    }
+
+    void Start(const TraceTag& tag, std::size_t worker) noexcept
+    {
+        if (!tag.Sampled())
+            return;
+
+        const auto now = TraceNow();
+        const auto self = static_cast<std::uint32_t>(worker);
+
+        Record(tag.Posted(), tag.Id(), self, from_ == kOwn ? self : from_, TraceEvent::Posted);
+        Record(now, tag.Id(), self, from_ == kOwn ? self : from_, from_ == kOwn || from_ == self ? TraceEvent::Dequeued : TraceEvent::Stolen);
+        Record(now, tag.Id(), self, self, TraceEvent::Started);
+    }
+
+    void Finish(const TraceTag& tag, std::size_t worker) noexcept
+    {
+        from_ = kOwn;
+
+        if (tag.Sampled())
+            Record(TraceNow(), tag.Id(), static_cast<std::uint32_t>(worker), static_cast<std::uint32_t>(worker), TraceEvent::Finished);
+    }
+
+    // Appends what's still in the ring, oldest first
+    void Read(std::vector<TraceRecord>& out) const
+    {
+        const auto end = head_.load(std::memory_order_acquire);
+        const auto begin = end > kCapacity ? end - kCapacity : 0;
+        const auto size = out.size();
+
+        for (auto index = begin; index < end; ++index) {
+            const auto& slot = slots_[index & (kCapacity - 1)];
+
+            out.push_back({ slot.time.load(std::memory_order_relaxed), slot.id.load(std::memory_order_relaxed),
+                slot.worker.load(std::memory_order_relaxed), slot.from.load(std::memory_order_relaxed),
+                static_cast<TraceEvent>(slot.event.load(std::memory_order_relaxed)) });
+        }
+
+        // Whatever the writer lapped while this read is dropped
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        const auto lapped = head_.load(std::memory_order_relaxed);
+        const auto valid = lapped > kCapacity ? lapped - kCapacity : 0;
+
+        if (valid > begin)
+            out.erase(out.begin() + static_cast<std::ptrdiff_t>(size), out.begin() + static_cast<std::ptrdiff_t>(size + std::min(valid, end) - begin));
+    }
+
+private:
+    static constexpr std::uint32_t kOwn = ~std::uint32_t { 0 };
+
+    struct Slot {
+        std::atomic_uint64_t time { 0 };
+        std::atomic_uint64_t id { 0 };
+        std::atomic_uint32_t worker { 0 };
+        std::atomic_uint32_t from { 0 };
+        std::atomic_uint8_t event { 0 };
+    };
+
+    void Record(std::uint64_t time, std::uint64_t id, std::uint32_t worker, std::uint32_t from, TraceEvent event) noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& slot = slots_[head & (kCapacity - 1)];
+
+        // Published before the slot changes, so that a reader learns it might have been lapped
+        head_.store(head + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.time.store(time, std::memory_order_relaxed);
+        slot.id.store(id, std::memory_order_relaxed);
+        slot.worker.store(worker, std::memory_order_relaxed);
+        slot.from.store(from, std::memory_order_relaxed);
+        slot.event.store(static_cast<std::uint8_t>(event), std::memory_order_relaxed);
+    }
+
+    std::atomic_size_t head_ { 0 };
+    std::uint32_t from_ { kOwn };
+    std::unique_ptr<Slot[]> slots_ { std::make_unique<Slot[]>(kCapacity) };
+};
+
+#else
+
+// Empty stand-ins that compile away
+struct TraceTag {
+    static TraceTag Sample() noexcept
+    {
+        return {};
+    }
+};
+
+struct Tracer {
+    void Take(std::size_t) noexcept { }
+    void Start(const TraceTag&, std::size_t) noexcept { }
+    void Finish(const TraceTag&, std::size_t) noexcept { }
+    void Read(std::vector<TraceRecord>&) const { }
+};
+
+#endif
+
+} // namespace detail
+
+inline void SetTraceSampling([[maybe_unused]] std::uint32_t every) noexcept
+{
+#if defined(TASKER_USE_TRACE)
+    detail::trace_sampling.store(every, std::memory_order_relaxed);
+#endif
+}
+
+#endif // TRACE_H_
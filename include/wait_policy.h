@@ -0,0 +1,50 @@
+#ifndef WAIT_POLICY_H_
+#define WAIT_POLICY_H_
+
+#include <cstddef>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// How long an idle worker keeps looking for work before it parks on its queue
+//
+// It busy spins with a pause instruction for spin rounds, then yields its time slice for yield rounds.
+// The default parks right away, which is the cheapest for throughput and the slowest to wake up.
+struct WaitPolicy {
+    std::size_t spin { 0 };
+    std::size_t yield { 0 };
+};
+
+inline void CpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+// Returns true as soon as ready() does, false once the policy is exhausted and the caller should park
+template <typename Ready>
+bool SpinWait(const WaitPolicy& policy, Ready ready)
+{
+    for (std::size_t round = 0; round < policy.spin; ++round) {
+        if (ready())
+            return true;
+
+        CpuRelax();
+    }
+
+    for (std::size_t round = 0; round < policy.yield; ++round) {
+        if (ready())
+            return true;
+
+        std::this_thread::yield();
+    }
+
+    return false;
+}
+
+#endif // WAIT_POLICY_H_
@@ -0,0 +1,146 @@
+#ifndef WORK_STEALING_DEQUE_H_
+#define WORK_STEALING_DEQUE_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "platform.h"
+
+// Fixed size Chase-Lev deque
+//
+// The owner thread pushes and pops at the bottom (LIFO), any other thread steals from the top (FIFO).
+// Each slot has its own occupied flag so that the owner never overwrites an item a thief is still moving out,
+// which lets the ring have a fixed capacity without a growable buffer. Push fails instead when it's full.
+template <typename T, std::size_t Capacity = 256>
+class WorkStealingDeque {
+public:
+    using value_type = T;
+
+    static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+    static_assert(std::is_nothrow_move_constructible_v<T>);
+
+    WorkStealingDeque() = default;
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    ~WorkStealingDeque()
+    {
+        while (Pop())
+            ;
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+    // Approximate unless it's called by the owner
+    std::size_t Size() const
+    {
+        const auto t = top_.load(std::memory_order_relaxed);
+        const auto b = bottom_.load(std::memory_order_relaxed);
+
+        return b > t ? static_cast<std::size_t>(b - t) : 0;
+    }
+
+    // Owner only
+    template <typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        const auto b = bottom_.load(std::memory_order_relaxed);
+        const auto t = top_.load(std::memory_order_acquire);
+
+        if (b - t >= static_cast<std::int64_t>(Capacity))
+            return false;
+
+        auto& slot = slots_[b & kMask];
+
+        // A thief won this slot on the previous lap but hasn't moved its item out yet
+        if (slot.occupied.load(std::memory_order_acquire))
+            return false;
+
+        ::new (static_cast<void*>(slot.storage)) T(std::forward<Args>(args)...);
+        slot.occupied.store(true, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Owner only
+    std::optional<T> Pop()
+    {
+        std::optional<T> value;
+
+        const auto b = bottom_.load(std::memory_order_relaxed) - 1;
+
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+
+            return value;
+        }
+
+        // Race against thieves for the last item
+        if (t == b) {
+            const auto won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+
+            bottom_.store(b + 1, std::memory_order_relaxed);
+
+            if (!won)
+                return value;
+        }
+
+        Take(slots_[b & kMask], value);
+
+        return value;
+    }
+
+    // Any thread, fails spuriously when it loses a race
+    std::optional<T> Steal()
+    {
+        std::optional<T> value;
+
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto b = bottom_.load(std::memory_order_acquire);
+
+        if (t < b && top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            Take(slots_[t & kMask], value);
+
+        return value;
+    }
+
+private:
+    static constexpr std::int64_t kMask = Capacity - 1;
+
+    struct Slot {
+        std::atomic_bool occupied { false };
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    static void Take(Slot& slot, std::optional<T>& value)
+    {
+        auto* item = std::launder(reinterpret_cast<T*>(slot.storage));
+
+        value.emplace(std::move(*item));
+        item->~T();
+        slot.occupied.store(false, std::memory_order_release);
+    }
+
+    alignas(kCacheLineSize) std::atomic_int64_t top_ { 0 };
+    alignas(kCacheLineSize) std::atomic_int64_t bottom_ { 0 };
+    std::array<Slot, Capacity> slots_;
+};
+
+#endif // WORK_STEALING_DEQUE_H_
@@ -0,0 +1,303 @@
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "bound.h"
+#include "platform.h"
+#include "thread_cache.h"
+#include "wait_policy.h"
+
+struct PoolOptions {
+    WaitPolicy wait {};
+    Affinity affinity {};
+};
+
+// How a PooledTasker shares the pool with the others
+struct LaneOptions {
+    std::size_t weight { 1 }; // Items served per visit, relative to the other lanes
+    std::size_t concurrency { 0 }; // Workers serving this lane at once, 1 processing items in order, 0 for any number
+    Bound bound {};
+};
+
+namespace detail {
+
+// Queue of one PooledTasker as the pool sees it
+//
+// A worker calls TryAcquire(), then Run() and Release() if it got the lane, so that at most concurrency workers serve it.
+class Lane {
+public:
+    explicit Lane(LaneOptions options) noexcept
+        : weight_ { std::max<std::size_t>(options.weight, 1) }
+        , concurrency_ { options.concurrency != 0 ? options.concurrency : std::numeric_limits<std::size_t>::max() }
+    {
+    }
+
+    virtual ~Lane() = default;
+    Lane(const Lane&) = delete;
+    Lane& operator=(const Lane&) = delete;
+
+    virtual bool Empty() const = 0;
+
+    // Processes up to max items, returns how many it went through
+    virtual std::size_t Run(std::size_t max) = 0;
+
+    std::size_t Weight() const noexcept
+    {
+        return weight_;
+    }
+
+    bool TryAcquire() noexcept
+    {
+        if (Empty())
+            return false;
+
+        for (auto running = running_.load(std::memory_order_relaxed); running < concurrency_;) {
+            if (running_.compare_exchange_weak(running, running + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        }
+
+        return false;
+    }
+
+    // Under the mutex, so that Quiesce() can't return and let the lane go while this still touches it
+    void Release()
+    {
+        std::lock_guard lock { mutex_ };
+
+        if (running_.fetch_sub(1, std::memory_order_release) == 1 && draining_)
+            cv_.notify_all();
+    }
+
+    // Waits until the workers emptied the lane and none serves it anymore, once nothing gets pushed
+    void Drain()
+    {
+        std::unique_lock lock { mutex_ };
+
+        draining_ = true;
+        cv_.wait(lock, [this] { return running_.load(std::memory_order_relaxed) == 0 && Empty(); });
+    }
+
+    // Waits until no worker serves the lane
+    void Quiesce()
+    {
+        std::unique_lock lock { mutex_ };
+
+        draining_ = true;
+        cv_.wait(lock, [this] { return running_.load(std::memory_order_relaxed) == 0; });
+    }
+
+    // First exception thrown while processing, which the pool doesn't let escape to its workers
+    std::exception_ptr Error() const
+    {
+        std::lock_guard lock { error_mutex_ };
+
+        return error_;
+    }
+
+protected:
+    void Fail(std::exception_ptr error)
+    {
+        std::lock_guard lock { error_mutex_ };
+
+        if (!error_)
+            error_ = std::move(error);
+    }
+
+private:
+    std::size_t weight_;
+    std::size_t concurrency_;
+    std::atomic_size_t running_ { 0 };
+    bool draining_ { false };
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    mutable std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+} // namespace detail
+
+// Threads shared by any number of PooledTaskers, each one attached as a lane
+//
+// Workers visit lanes round robin, each from its own position, and serve up to weight * kQuantum items of a lane
+// before moving on, which shares the workers in proportion to the weights among busy lanes.
+// Idle workers park on one condition variable, and producers only touch it when somebody sleeps.
+class WorkerPool {
+public:
+    static constexpr std::size_t kQuantum = 16;
+
+    explicit WorkerPool(std::size_t count = 0, PoolOptions options = {})
+        : options_ { std::move(options) }
+    {
+        if (count == 0)
+            count = std::max(1u, std::thread::hardware_concurrency());
+
+        workers_.reserve(count);
+        for (std::size_t n = 0; n < count; ++n)
+            workers_.emplace_back(detail::Spawn(&WorkerPool::Run, this, n));
+    }
+
+    // Every PooledTasker has to be stopped before
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard lock { mutex_ };
+
+            done_ = true;
+        }
+
+        cv_.notify_all();
+
+        for (auto& worker : workers_)
+            worker.get();
+
+        assert(lanes_.empty());
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Process-wide pool with one worker per hardware thread, created on first use
+    static WorkerPool& Default()
+    {
+        static WorkerPool pool;
+
+        return pool;
+    }
+
+    std::size_t Count() const noexcept
+    {
+        return workers_.size();
+    }
+
+    void Attach(detail::Lane& lane)
+    {
+        std::lock_guard lock { lanes_mutex_ };
+
+        lanes_.push_back(&lane);
+    }
+
+    // No worker picks the lane up afterwards, though one might still be serving it
+    void Detach(detail::Lane& lane)
+    {
+        std::lock_guard lock { lanes_mutex_ };
+
+        std::erase(lanes_, &lane);
+    }
+
+    // Called after an item went into a lane, pairs with the fence in Park()
+    void Notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (sleepers_.load(std::memory_order_relaxed) == 0)
+            return;
+
+        {
+            std::lock_guard lock { mutex_ };
+
+            if (wakeups_ >= sleepers_.load(std::memory_order_relaxed))
+                return;
+
+            ++wakeups_;
+        }
+
+        cv_.notify_one();
+    }
+
+private:
+    void Run(std::size_t n)
+    {
+        std::size_t next = n;
+
+        detail::Pin(options_.affinity, n);
+
+        while (true) {
+            if (Serve(next))
+                continue;
+
+            if (SpinWait(options_.wait, [&] { return Serve(next); }))
+                continue;
+
+            if (!Park())
+                break;
+        }
+    }
+
+    // Serves the first lane from next on that has items and room for a worker, false if there's none
+    bool Serve(std::size_t& next)
+    {
+        detail::Lane* lane = nullptr;
+
+        {
+            std::shared_lock lock { lanes_mutex_ };
+
+            for (std::size_t offset = 0; offset < lanes_.size() && !lane; ++offset) {
+                const auto index = (next + offset) % lanes_.size();
+
+                if (lanes_[index]->TryAcquire()) {
+                    lane = lanes_[index];
+                    next = index + 1;
+                }
+            }
+        }
+
+        if (!lane)
+            return false;
+
+        const auto count = lane->Run(lane->Weight() * kQuantum);
+
+        lane->Release();
+
+        return count != 0;
+    }
+
+    bool Ready() const
+    {
+        std::shared_lock lock { lanes_mutex_ };
+
+        return std::ranges::any_of(lanes_, [](const detail::Lane* lane) { return !lane->Empty(); });
+    }
+
+    // False once the pool is destroyed
+    bool Park()
+    {
+        std::unique_lock lock { mutex_ };
+
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!done_ && !Ready())
+            cv_.wait(lock, [this] { return done_ || wakeups_ != 0; });
+
+        if (wakeups_ != 0)
+            --wakeups_;
+
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+        return !done_;
+    }
+
+    PoolOptions options_;
+    std::vector<std::future<void>> workers_;
+    std::vector<detail::Lane*> lanes_;
+    mutable std::shared_mutex lanes_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::size_t wakeups_ { 0 };
+    bool done_ { false };
+    alignas(kCacheLineSize) std::atomic_size_t sleepers_ { 0 };
+};
+
+#endif // WORKER_POOL_H_
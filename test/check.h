@@ -0,0 +1,16 @@
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+// Aborts the test binary with the failed condition, which ctest reports along with the output
+#define CHECK(condition)                                                                              \
+    do {                                                                                              \
+        if (!(condition)) {                                                                           \
+            std::fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", __FILE__, __LINE__, __func__, #condition); \
+            std::abort();                                                                             \
+        }                                                                                             \
+    } while (false)
+
+#endif // TEST_CHECK_H_
@@ -0,0 +1,140 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "check.h"
+#include "tasker.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+template <typename Tasker>
+Coroutine<std::thread::id> WorkerId(Tasker& tasker)
+{
+    co_await tasker.Schedule();
+
+    co_return std::this_thread::get_id();
+}
+
+template <typename Tasker>
+Coroutine<int> Twice(Tasker& tasker, int value)
+{
+    co_await tasker.Schedule();
+
+    co_return value * 2;
+}
+
+template <typename Tasker>
+Coroutine<int> Sum(Tasker& tasker)
+{
+    co_return co_await Twice(tasker, 1) + co_await Twice(tasker, 2);
+}
+
+template <typename Tasker>
+Coroutine<> Throw(Tasker& tasker)
+{
+    co_await tasker.Schedule();
+
+    throw std::runtime_error { "thrown on a worker" };
+}
+
+// The coroutine continues on a worker, and awaiting others there chains their results
+template <typename Tasker>
+void ScheduleResumesOnWorker()
+{
+    Tasker tasker { [](int) { } };
+
+    CHECK(WorkerId(tasker).Get() != std::this_thread::get_id());
+    CHECK(Sum(tasker).Get() == 6);
+}
+
+// What the coroutine throws on the worker comes out of Get()
+template <typename Tasker>
+void ExceptionReachesGet()
+{
+    Tasker tasker { [](int) { } };
+    auto thrown = false;
+
+    try {
+        Throw(tasker).Get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+}
+
+// co_await on a stopped Tasker throws right away, on the calling thread
+template <typename Tasker>
+void ScheduleAfterStop()
+{
+    Tasker tasker { [](int) { } };
+    auto thrown = false;
+
+    tasker.Stop();
+
+    try {
+        WorkerId(tasker).Get();
+    } catch (const std::future_error& error) {
+        thrown = error.code() == std::future_errc::broken_promise;
+    }
+
+    CHECK(thrown);
+}
+
+// A coroutine still queued when the Tasker aborts is resumed with the same error instead of being lost
+void AbortResumesQueued()
+{
+    std::atomic_bool started { false };
+    std::atomic_bool release { false };
+    Tasker<int, 1> tasker { [&](int) {
+        started = true;
+
+        while (!release.load())
+            std::this_thread::yield();
+    } };
+
+    CHECK(tasker.Post(1));
+
+    while (!started.load())
+        std::this_thread::yield();
+
+    auto waiter = std::async(std::launch::async, [&] { return WorkerId(tasker).Get(); });
+
+    while (tasker.Size() < 1)
+        std::this_thread::yield();
+
+    std::thread abort { [&] { tasker.Abort(); } };
+
+    std::this_thread::sleep_for(20ms);
+    release = true;
+    abort.join();
+
+    auto thrown = false;
+
+    try {
+        waiter.get();
+    } catch (const std::future_error& error) {
+        thrown = error.code() == std::future_errc::broken_promise;
+    }
+
+    CHECK(thrown);
+}
+
+} // namespace
+
+int main()
+{
+    ScheduleResumesOnWorker<Tasker<int, 1>>();
+    ScheduleResumesOnWorker<Tasker<int, 4>>();
+    ExceptionReachesGet<Tasker<int, 1>>();
+    ExceptionReachesGet<Tasker<int, 4>>();
+    ScheduleAfterStop<Tasker<int, 1>>();
+    ScheduleAfterStop<Tasker<int, 4>>();
+    AbortResumesQueued();
+
+    return 0;
+}
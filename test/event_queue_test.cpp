@@ -0,0 +1,174 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+#include "check.h"
+#include "tasker.h"
+
+#if defined(TASKER_HAS_EPOLL)
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// A consumer parked in the loop gets every item pushed from another thread
+void WakeOnPush()
+{
+    EventQueue<int> queue;
+    std::atomic_int sum { 0 };
+
+    std::thread consumer { [&] {
+        for (auto count = 0; count < 100; ++count)
+            sum += queue.Pop().value_or(0);
+    } };
+
+    for (auto value = 1; value <= 100; ++value) {
+        // Every few items, long enough for the consumer to park first
+        if (value % 10 == 0)
+            std::this_thread::sleep_for(5ms);
+
+        CHECK(queue.Push(value));
+    }
+
+    consumer.join();
+
+    CHECK(sum.load() == 5050);
+}
+
+// Stop ends a parked Pop, but only after what was pushed before it is drained
+void StopWakesPop()
+{
+    EventQueue<int> queue;
+    std::optional<int> last { 0 };
+
+    std::thread consumer { [&] { last = queue.Pop(); } };
+
+    std::this_thread::sleep_for(20ms);
+    queue.Stop();
+    consumer.join();
+
+    CHECK(!last);
+
+    EventQueue<int> stopped;
+
+    CHECK(stopped.Push(1));
+    CHECK(stopped.Push(2));
+    stopped.Stop();
+
+    CHECK(!stopped.Push(3));
+    CHECK(stopped.Pop() == 1);
+    CHECK(stopped.Pop() == 2);
+    CHECK(!stopped.Pop());
+}
+
+#if defined(TASKER_HAS_EPOLL)
+// A watched fd getting ready runs its handler on the parked consumer, which keeps waiting for an item
+void HandlerRunsOnConsumer()
+{
+    EventQueue<int> queue;
+    int fds[2];
+    std::atomic_bool handled { false };
+    std::thread::id handler;
+
+    CHECK(pipe(fds) == 0);
+    CHECK(queue.Events().Watch(fds[0], EPOLLIN, [&](std::uint32_t events) {
+        char byte;
+
+        CHECK((events & EPOLLIN) != 0);
+        CHECK(read(fds[0], &byte, 1) == 1);
+
+        handler = std::this_thread::get_id();
+        handled = true;
+    }));
+    CHECK(!queue.Events().Watch(fds[0], EPOLLIN, [](std::uint32_t) {}));
+
+    std::thread::id id;
+    std::thread consumer { [&] {
+        id = std::this_thread::get_id();
+
+        CHECK(queue.Pop() == 42);
+    } };
+
+    std::this_thread::sleep_for(20ms);
+    CHECK(write(fds[1], "x", 1) == 1);
+
+    while (!handled)
+        std::this_thread::sleep_for(1ms);
+
+    CHECK(queue.Push(42));
+    consumer.join();
+
+    CHECK(handler == id);
+    CHECK(queue.Events().Unwatch(fds[0]));
+    CHECK(!queue.Events().Unwatch(fds[0]));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// Handlers and posted items share the worker of a Tasker on an EventQueue
+template <std::size_t N>
+void TaskerHandlesBoth()
+{
+    int fds[2];
+    std::atomic_int items { 0 };
+    std::atomic_int reads { 0 };
+
+    CHECK(pipe(fds) == 0);
+
+    {
+        Tasker<int, N, EventQueue<int>> tasker { [&](int) { ++items; } };
+
+        auto& loop = [&]() -> EventLoop& {
+            if constexpr (N == 1)
+                return tasker.Events();
+            else
+                return tasker.Events(0);
+        }();
+
+        CHECK(loop.Watch(fds[0], EPOLLIN, [&](std::uint32_t) {
+            char byte;
+
+            reads += static_cast<int>(read(fds[0], &byte, 1));
+        }));
+
+        for (auto count = 0; count < 10; ++count) {
+            CHECK(write(fds[1], "x", 1) == 1);
+            CHECK(tasker.Post(count));
+            std::this_thread::sleep_for(2ms);
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+
+        while ((items != 10 || reads != 10) && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(1ms);
+
+        CHECK(items.load() == 10);
+        CHECK(reads.load() == 10);
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+}
+#endif
+
+} // namespace
+
+int main()
+{
+    WakeOnPush();
+    StopWakesPop();
+
+#if defined(TASKER_HAS_EPOLL)
+    HandlerRunsOnConsumer();
+    TaskerHandlesBoth<1>();
+    TaskerHandlesBoth<2>();
+#endif
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "tasker.h"
+
+namespace {
+
+// Every element is visited exactly once, whatever the size and the grain
+template <typename Executor>
+void ForVisitsEachOnce(Executor& executor)
+{
+    for (const std::size_t size : { 0, 1, 7, 1000, 100000 }) {
+        for (const std::size_t grain : { 0, 1, 64 }) {
+            std::vector<std::atomic_int> visits(size);
+
+            executor.ParallelFor(visits, [](std::atomic_int& value) { ++value; }, grain);
+
+            for (const auto& value : visits)
+                CHECK(value.load() == 1);
+        }
+    }
+}
+
+template <typename Executor>
+void ReduceMatchesSequential(Executor& executor)
+{
+    std::vector<int> values(100000);
+
+    std::iota(values.begin(), values.end(), 0);
+
+    const auto expected = std::accumulate(values.begin(), values.end(), 0LL);
+
+    CHECK(executor.ParallelReduce(values, 0LL, std::plus<> {}, [](int value) { return value * 1LL; }) == expected);
+    CHECK(executor.ParallelReduce(values, 0LL, std::plus<> {}, [](int value) { return value * 1LL; }, 1) == expected);
+    CHECK(executor.ParallelReduce(values, 0, [](int a, int b) { return std::max(a, b); }) == 99999);
+    CHECK(executor.ParallelReduce(std::vector<int> {}, 42, std::plus<> {}) == 42);
+}
+
+// The first exception stops the loop and comes out of the call, after which the Executor runs loops as before
+template <typename Executor>
+void ExceptionsPropagate(Executor& executor)
+{
+    std::vector<int> values(100000, 1);
+    auto thrown = false;
+
+    try {
+        executor.ParallelFor(values, [&](int& value) {
+            if (&value - values.data() == 5000)
+                throw std::runtime_error { "element" };
+        }, 16);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+
+    thrown = false;
+
+    try {
+        executor.ParallelReduce(values, 0, [](int, int) -> int { throw std::logic_error { "reduce" }; });
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+    CHECK(executor.ParallelReduce(values, 0, std::plus<> {}) == 100000);
+}
+
+// Loops started from inside a loop finish even with every worker busy in the outer one
+template <typename Executor>
+void Nested(Executor& executor)
+{
+    std::vector<int> outer(64);
+    std::atomic_size_t total { 0 };
+
+    executor.ParallelFor(outer, [&](int&) {
+        std::vector<int> inner(1000, 1);
+
+        total += static_cast<std::size_t>(executor.ParallelReduce(inner, 0, std::plus<> {}));
+    }, 1);
+
+    CHECK(total.load() == 64 * 1000);
+}
+
+template <typename Executor>
+void Run()
+{
+    Executor executor;
+
+    ForVisitsEachOnce(executor);
+    ReduceMatchesSequential(executor);
+    ExceptionsPropagate(executor);
+    Nested(executor);
+}
+
+} // namespace
+
+int main()
+{
+    Run<Executor<4>>();
+    Run<Executor<2>>();
+    Run<Executor<>>();
+
+    return 0;
+}
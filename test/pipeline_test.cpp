@@ -0,0 +1,55 @@
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "check.h"
+#include "pipeline.h"
+
+namespace {
+
+constexpr std::size_t kRounds = 1000;
+
+// Posts one item at a time and waits for it to leave the last stage, each stage handing it over once
+template <typename Pipeline>
+void PostAndWaitIdle(Pipeline& pipeline, const std::atomic_size_t& sunk)
+{
+    for (std::size_t round = 1; round <= kRounds; ++round) {
+        CHECK(pipeline.Post(std::to_string(round)));
+        pipeline.WaitIdle();
+        CHECK(sunk.load() == round);
+    }
+}
+
+void WaitIdleSingleWorkers()
+{
+    std::atomic_size_t sunk { 0 };
+    Pipeline pipeline {
+        Stage([](std::string line) { return std::stoi(line); }),
+        Fuse([](int value) { return value < 0 ? 0 : value; }),
+        Stage([&](int) { ++sunk; }),
+    };
+
+    PostAndWaitIdle(pipeline, sunk);
+}
+
+void WaitIdleMultiWorker()
+{
+    std::atomic_size_t sunk { 0 };
+    Pipeline pipeline {
+        Stage<4>([](std::string line) { return std::stoi(line); }),
+        Stage([](int value) { return value * 2; }, 16),
+        Stage([&](int) { ++sunk; }),
+    };
+
+    PostAndWaitIdle(pipeline, sunk);
+}
+
+} // namespace
+
+int main()
+{
+    WaitIdleSingleWorkers();
+    WaitIdleMultiWorker();
+
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "concurrent_queue.h"
+#include "priority_queue.h"
+#include "ring_queue.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// A queue moved into keeps the capacity and overflow of the one it got the items from, as when moved into being
+template <typename Queue>
+void MoveAssignKeepsBound()
+{
+    Queue queue;
+    Queue other { Bound { 2, Overflow::Reject } };
+
+    CHECK(other.Push(1));
+    queue = std::move(other);
+
+    CHECK(queue.Capacity() == 2);
+    CHECK(queue.Push(2));
+    CHECK(!queue.Push(3));
+    CHECK(queue.Size() == 2);
+}
+
+// Built from an int by a constructor that may throw, which RingQueue runs before claiming a slot
+struct Boxed {
+    explicit Boxed(int value) noexcept(false)
+        : value { value }
+    {
+    }
+
+    Boxed(Boxed&&) noexcept = default;
+    Boxed& operator=(Boxed&&) noexcept = default;
+
+    int value;
+};
+
+// Producers racing for the last slots fail once the ring is full instead of waiting for a consumer
+void RingTryEmplaceNeverBlocks()
+{
+    RingQueue<Boxed> queue { Bound { 2, Overflow::Reject } };
+    std::vector<std::thread> producers;
+
+    for (int n = 0; n < 4; ++n) {
+        producers.emplace_back([&] {
+            for (int value = 0; value < 1000; ++value) {
+                queue.TryEmplace(value);
+                queue.Offer(value);
+            }
+        });
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+
+    CHECK(queue.Size() == 2);
+    CHECK(!queue.TryEmplace(0));
+}
+
+// The most urgent lane goes first, but a lane passed over Quantum times gets the next turn
+void PriorityAging()
+{
+    PriorityQueue<int, 2, 3> queue;
+
+    for (int n = 0; n < 6; ++n)
+        CHECK(queue.Push(Priority { 0 }, n));
+
+    CHECK(queue.Push(100));
+    CHECK(queue.Push(101));
+
+    for (int expected : { 0, 1, 2, 100, 3, 4, 5, 101 })
+        CHECK(queue.TryPop() == expected);
+
+    CHECK(!queue.TryPop());
+}
+
+// DropOldest makes room at the expense of the least urgent lane that has items
+void PriorityDropOldest()
+{
+    PriorityQueue<int, 3> queue { Bound { 3, Overflow::DropOldest } };
+
+    CHECK(queue.Push(Priority { 0 }, 0));
+    CHECK(queue.Push(Priority { 1 }, 1));
+    CHECK(queue.Push(2));
+    CHECK(queue.Push(Priority { 0 }, 3));
+    CHECK(queue.Push(Priority { 0 }, 4));
+
+    CHECK(queue.Dropped() == 2);
+
+    for (int expected : { 0, 3, 4 })
+        CHECK(queue.TryPop() == expected);
+}
+
+// Capacity rounds up to a power of two, and a full ring fails or evicts as its overflow says
+void RingFull()
+{
+    RingQueue<int> reject { Bound { 3, Overflow::Reject } };
+
+    CHECK(reject.Capacity() == 4);
+
+    for (int n = 0; n < 4; ++n)
+        CHECK(reject.Push(n));
+
+    CHECK(!reject.Push(4));
+    CHECK(!reject.Offer(4));
+    CHECK(!reject.TryPush(4));
+    CHECK(reject.Size() == 4);
+
+    RingQueue<int> drop { Bound { 4, Overflow::DropOldest } };
+
+    for (int n = 0; n < 6; ++n)
+        CHECK(drop.Push(n));
+
+    CHECK(!drop.TryPush(6));
+    CHECK(drop.Dropped() == 2);
+
+    for (int n = 2; n < 6; ++n)
+        CHECK(drop.TryPop() == n);
+
+    CHECK(!drop.TryPop());
+}
+
+// A producer blocked on a full ring goes on once a consumer makes room, and fails once the ring is stopped
+void RingBlock()
+{
+    RingQueue<int> queue { Bound { 2, Overflow::Block } };
+    std::atomic_bool pushed { false };
+
+    CHECK(queue.Push(0));
+    CHECK(queue.Push(1));
+
+    std::thread producer { [&] { pushed = queue.Push(2); } };
+
+    std::this_thread::sleep_for(20ms);
+    CHECK(!pushed.load());
+    CHECK(queue.Pop() == 0);
+    producer.join();
+    CHECK(pushed.load());
+
+    std::thread stopped { [&] { pushed = queue.Push(3); } };
+
+    std::this_thread::sleep_for(20ms);
+    queue.Stop();
+    stopped.join();
+    CHECK(!pushed.load());
+}
+
+// A stopped ring refuses items but still hands out what it holds, and a consumer blocked on it gets nothing
+void RingStop()
+{
+    RingQueue<int> queue;
+
+    CHECK(queue.Push(1));
+    CHECK(queue.Push(2));
+    queue.Stop();
+
+    CHECK(!queue.Push(3));
+    CHECK(!queue.TryPush(3));
+    CHECK(queue.Pop() == 1);
+    CHECK(queue.Pop() == 2);
+    CHECK(!queue.Pop());
+
+    RingQueue<int> empty;
+    std::optional<int> popped { 0 };
+    std::thread consumer { [&] { popped = empty.Pop(); } };
+
+    std::this_thread::sleep_for(20ms);
+    empty.Stop();
+    consumer.join();
+    CHECK(!popped);
+}
+
+// Every item pushed by several producers comes out exactly once, in order per producer
+void RingProducersConsumers()
+{
+    constexpr int kProducers = 4;
+    constexpr int kItems = 10000;
+
+    RingQueue<int> queue { Bound { 64 } };
+    std::vector<std::thread> threads;
+    std::vector<std::vector<int>> popped(kProducers);
+    std::atomic_int count { 0 };
+
+    for (int producer = 0; producer < kProducers; ++producer) {
+        threads.emplace_back([&, producer] {
+            for (int n = 0; n < kItems; ++n)
+                CHECK(queue.Push(producer * kItems + n));
+        });
+    }
+
+    // One consumer, so that the order it pops items in is the order they were pushed in
+    threads.emplace_back([&] {
+        while (auto value = queue.Pop()) {
+            popped[static_cast<std::size_t>(*value / kItems)].push_back(*value % kItems);
+
+            if (++count == kProducers * kItems)
+                break;
+        }
+    });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& values : popped) {
+        CHECK(values.size() == kItems);
+
+        for (int n = 0; n < kItems; ++n)
+            CHECK(values[static_cast<std::size_t>(n)] == n);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    MoveAssignKeepsBound<ConcurrentQueue<int>>();
+    MoveAssignKeepsBound<PriorityQueue<int, 2>>();
+    PriorityAging();
+    PriorityDropOldest();
+    RingTryEmplaceNeverBlocks();
+    RingFull();
+    RingBlock();
+    RingStop();
+    RingProducersConsumers();
+
+    return 0;
+}
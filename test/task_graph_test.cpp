@@ -0,0 +1,172 @@
+#include <atomic>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "tasker.h"
+
+namespace {
+
+// A layered graph with random edges, each node checks that its dependencies finished before it started
+class Layered {
+public:
+    explicit Layered(std::size_t layers, std::size_t width)
+        : done_(layers * width)
+    {
+        std::mt19937 random { 7 };
+
+        for (std::size_t layer = 0; layer < layers; ++layer) {
+            for (std::size_t column = 0; column < width; ++column) {
+                std::vector<TaskGraph::Node> dependencies;
+
+                if (layer != 0) {
+                    for (std::size_t other = 0; other < width; ++other) {
+                        if (random() % 3 == 0)
+                            dependencies.push_back((layer - 1) * width + other);
+                    }
+                }
+
+                const auto node = graph_.Add([this, node = graph_.Size(), dependencies] {
+                    for (auto dependency : dependencies) {
+                        if (done_[dependency].load(std::memory_order_acquire) != run_ + 1)
+                            ordered_ = false;
+                    }
+
+                    done_[node].fetch_add(1, std::memory_order_release);
+                });
+
+                for (auto dependency : dependencies)
+                    graph_.Depend(node, dependency);
+            }
+        }
+    }
+
+    // Every node ran once more, and never ahead of its dependencies
+    template <typename Executor>
+    void Run(Executor& executor)
+    {
+        graph_.Run(executor);
+
+        CHECK(ordered_.load());
+
+        ++run_;
+
+        for (const auto& done : done_)
+            CHECK(done.load() == run_);
+    }
+
+private:
+    TaskGraph graph_;
+    std::vector<std::atomic_size_t> done_;
+    std::size_t run_ { 0 };
+    std::atomic_bool ordered_ { true };
+};
+
+template <typename Executor>
+void Ordering(Executor& executor)
+{
+    Layered layered { 16, 16 };
+
+    for (auto run = 0; run < 50; ++run)
+        layered.Run(executor);
+}
+
+// The first exception comes out of Run() and what depends on the failed node is skipped, the next run starts over
+template <typename Executor>
+void Rethrow(Executor& executor)
+{
+    TaskGraph graph;
+    std::atomic_int after { 0 };
+    auto fail = true;
+
+    const auto root = graph.Add([] {});
+    const auto thrower = graph.Add([&] {
+        if (fail)
+            throw std::runtime_error { "node" };
+    }, { root });
+
+    graph.Add([&] { ++after; }, { thrower });
+
+    auto thrown = false;
+
+    try {
+        graph.Run(executor);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+
+    CHECK(thrown);
+    CHECK(after.load() == 0);
+
+    fail = false;
+    graph.Run(executor);
+
+    CHECK(after.load() == 1);
+}
+
+// Several nodes throwing still rethrows a single exception
+template <typename Executor>
+void RethrowMany(Executor& executor)
+{
+    TaskGraph graph;
+
+    for (auto node = 0; node < 64; ++node)
+        graph.Add([] { throw std::logic_error { "node" }; });
+
+    for (auto run = 0; run < 10; ++run) {
+        auto thrown = false;
+
+        try {
+            graph.Run(executor);
+        } catch (const std::logic_error&) {
+            thrown = true;
+        }
+
+        CHECK(thrown);
+    }
+}
+
+// Graphs run from within nodes of another one finish even with every worker busy in the outer one
+template <typename Executor>
+void Nested(Executor& executor)
+{
+    std::atomic_int inner_runs { 0 };
+    TaskGraph outer;
+
+    for (auto node = 0; node < 8; ++node) {
+        outer.Add([&] {
+            TaskGraph inner;
+            const auto first = inner.Add([&] { ++inner_runs; });
+
+            inner.Add([&] { ++inner_runs; }, { first });
+            inner.Run(executor);
+        });
+    }
+
+    outer.Run(executor);
+
+    CHECK(inner_runs.load() == 16);
+}
+
+template <typename Executor>
+void Run()
+{
+    Executor executor;
+
+    Ordering(executor);
+    Rethrow(executor);
+    RethrowMany(executor);
+    Nested(executor);
+}
+
+} // namespace
+
+int main()
+{
+    Run<Executor<4>>();
+    Run<Executor<1>>();
+
+    return 0;
+}
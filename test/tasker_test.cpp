@@ -0,0 +1,429 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "tasker.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t kRounds = 1000;
+
+// Posts one item at a time and waits for each, which catches a worker that parks before the item counts as done
+template <typename Tasker>
+void PostAndWaitIdle(Tasker& tasker, const std::atomic_size_t& processed)
+{
+    for (std::size_t round = 1; round <= kRounds; ++round) {
+        CHECK(tasker.Post(1));
+        CHECK(tasker.WaitIdleFor(5s));
+        CHECK(processed.load() == round);
+    }
+}
+
+template <typename Queue>
+class SingleWorker : public TaskerBase<SingleWorker<Queue>, int, 1, Queue> {
+public:
+    explicit SingleWorker(std::atomic_size_t& processed)
+        : processed_ { &processed }
+    {
+    }
+
+    ~SingleWorker()
+    {
+        this->Stop();
+    }
+
+    void Process(int value)
+    {
+        processed_->fetch_add(static_cast<std::size_t>(value));
+    }
+
+private:
+    std::atomic_size_t* processed_;
+};
+
+// Processes items once release is set
+struct Gate {
+    std::atomic_size_t processed { 0 };
+    std::atomic_bool release { false };
+
+    void operator()(int value)
+    {
+        while (!release.load())
+            std::this_thread::yield();
+
+        processed += static_cast<std::size_t>(value);
+    }
+};
+
+template <std::size_t N, typename Queue>
+class Gated : public TaskerBase<Gated<N, Queue>, int, N, Queue> {
+public:
+    explicit Gated(Gate& gate)
+        : gate_ { &gate }
+    {
+    }
+
+    ~Gated()
+    {
+        this->Stop();
+    }
+
+    Gated(Gated&&) = default;
+    Gated& operator=(Gated&&) = default;
+
+    void Process(int value)
+    {
+        (*gate_)(value);
+    }
+
+private:
+    Gate* gate_;
+};
+
+void WaitIdleAfterPost()
+{
+    std::atomic_size_t processed { 0 };
+    Tasker<int, 1> tasker { [&](int value) { processed += static_cast<std::size_t>(value); } };
+
+    PostAndWaitIdle(tasker, processed);
+}
+
+void WaitIdleAfterPostSpsc()
+{
+    std::atomic_size_t processed { 0 };
+    Tasker<int, 1, SpscQueue<int>> tasker { [&](int value) { processed += static_cast<std::size_t>(value); } };
+
+    PostAndWaitIdle(tasker, processed);
+}
+
+void WaitIdleAfterPostMultiWorker()
+{
+    std::atomic_size_t processed { 0 };
+    Tasker<int, 4> tasker { [&](int value) { processed += static_cast<std::size_t>(value); } };
+
+    PostAndWaitIdle(tasker, processed);
+}
+
+void WaitIdleAfterPostTaskerBase()
+{
+    std::atomic_size_t processed { 0 };
+    SingleWorker<ConcurrentQueue<int>> tasker { processed };
+
+    PostAndWaitIdle(tasker, processed);
+}
+
+void WaitIdleAfterRejectedPosts()
+{
+    Gate gate;
+    Tasker<int, 1> tasker { [&](int value) { gate(value); }, { .bound = { 1, Overflow::Reject } } };
+    std::size_t accepted = 0;
+
+    for (std::size_t n = 0; n < 100; ++n)
+        accepted += tasker.TryPost(1) ? 1 : 0;
+
+    CHECK(accepted < 100);
+    CHECK(!tasker.WaitIdleFor(10ms));
+
+    gate.release = true;
+
+    CHECK(tasker.WaitIdleFor(5s));
+    CHECK(gate.processed.load() == accepted);
+}
+
+void WaitIdleAfterEvictions()
+{
+    Gate gate;
+    Tasker<int, 1> tasker { [&](int value) { gate(value); }, { .bound = { 4, Overflow::DropOldest } } };
+
+    for (std::size_t n = 0; n < 100; ++n)
+        CHECK(tasker.Post(1));
+
+    gate.release = true;
+
+    CHECK(tasker.WaitIdleFor(5s));
+    CHECK(gate.processed.load() < 100);
+}
+
+void WaitIdleAfterClear()
+{
+    Gate gate;
+    Tasker<int, 1, SpscQueue<int>> tasker { [&](int value) { gate(value); }, { .bound = { 128 } } };
+
+    for (std::size_t n = 0; n < 100; ++n)
+        CHECK(tasker.Post(1));
+
+    tasker.Clear();
+    gate.release = true;
+
+    CHECK(tasker.WaitIdleFor(5s));
+    CHECK(gate.processed.load() < 100);
+}
+
+// Items moved into a Tasker whose worker is parked get processed without another post to wake it
+template <std::size_t N, typename Queue>
+void WaitIdleAfterMoveAssign()
+{
+    Gate gate;
+    Gated<N, Queue> tasker { gate };
+    Gated<N, Queue> other { gate };
+
+    for (std::size_t n = 0; n < 10; ++n)
+        CHECK(other.Post(1));
+
+    // The move joins other's workers, which wait for the gate with the items they took
+    std::thread release { [&] {
+        std::this_thread::sleep_for(50ms);
+        gate.release = true;
+    } };
+
+    tasker = std::move(other);
+    release.join();
+
+    CHECK(tasker.WaitIdleFor(5s));
+    CHECK(gate.processed.load() == 10);
+}
+
+// Urgent items posted behind others overtake them while the worker is busy
+void PostPriority()
+{
+    std::atomic_bool started { false };
+    std::atomic_bool release { false };
+    std::vector<int> order;
+    Tasker<int, 1, PriorityQueue<int, 2>> tasker { [&](int value) {
+        started = true;
+
+        while (!release.load())
+            std::this_thread::yield();
+
+        order.push_back(value);
+    } };
+
+    CHECK(tasker.Post(0));
+
+    while (!started.load())
+        std::this_thread::yield();
+
+    CHECK(tasker.Post(1));
+    CHECK(tasker.Post(2));
+    CHECK(tasker.Post(Priority { 0 }, 3));
+
+    release = true;
+
+    CHECK(tasker.WaitIdleFor(5s));
+    CHECK((order == std::vector<int> { 0, 3, 1, 2 }));
+}
+
+// Items of one key run in posting order on one worker, while plain items around them run anywhere
+void PostKeyedOrder()
+{
+    constexpr int kKeys = 8;
+    constexpr int kItems = 2000;
+
+    std::mutex mutex;
+    std::vector<std::vector<int>> order(kKeys);
+    std::vector<std::thread::id> owner(kKeys);
+    auto owned = true;
+    Tasker<int, 4> tasker { [&](int value) {
+        if (value < 0)
+            return;
+
+        const auto key = static_cast<std::size_t>(value / kItems);
+        std::lock_guard lock { mutex };
+
+        if (order[key].empty())
+            owner[key] = std::this_thread::get_id();
+        else
+            owned = owned && owner[key] == std::this_thread::get_id();
+
+        order[key].push_back(value % kItems);
+    } };
+
+    for (int n = 0; n < kItems; ++n) {
+        for (int key = 0; key < kKeys; ++key)
+            CHECK(tasker.PostKeyed(key, key * kItems + n));
+
+        CHECK(tasker.Post(-1));
+    }
+
+    CHECK(tasker.WaitIdleFor(5s));
+
+    std::lock_guard lock { mutex };
+
+    CHECK(owned);
+
+    for (const auto& values : order) {
+        CHECK(values.size() == kItems);
+
+        for (int n = 0; n < kItems; ++n)
+            CHECK(values[static_cast<std::size_t>(n)] == n);
+    }
+}
+
+// Under load extra workers start up to Elastic::max, and they give their threads back once idle for long enough
+void ElasticGrowShrink()
+{
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    Tasker<int, 2> tasker { [&](int) {
+        {
+            std::lock_guard lock { mutex };
+
+            threads.insert(std::this_thread::get_id());
+        }
+
+        std::this_thread::sleep_for(1ms);
+    }, { .elastic = { .max = 4, .depth = 4, .idle = 50ms } } };
+
+    for (int round = 0; round < 2; ++round) {
+        for (int n = 0; n < 200; ++n)
+            CHECK(tasker.Post(n));
+
+        CHECK(tasker.WaitIdleFor(5s));
+
+        const auto cached = detail::ThreadCache::Instance().Idle();
+
+        // Past the idle time, the extra workers retire and their threads wait in the cache
+        std::this_thread::sleep_for(300ms);
+
+        std::lock_guard lock { mutex };
+
+        CHECK(threads.size() > 2 && threads.size() <= 4);
+        CHECK(detail::ThreadCache::Instance().Idle() >= cached + threads.size() - 2);
+
+        threads.clear();
+    }
+}
+
+// Every way in fails once stopped, instead of touching the state of workers that are gone
+template <typename Tasker>
+void PostAfterStop(Tasker& tasker)
+{
+    const std::vector<int> values { 1, 2, 3 };
+
+    tasker.Stop();
+
+    CHECK(!tasker.Post(1));
+    CHECK(!tasker.TryPost(1));
+    CHECK(!tasker.PostKeyed(7, 1));
+    CHECK(tasker.PostRange(values) == 0);
+    CHECK(tasker.Size() == 0);
+    CHECK(tasker.WaitIdleFor(5s));
+}
+
+void PostAfterStopSingleWorker()
+{
+    Tasker<int, 1> tasker { [](int) { } };
+
+    PostAfterStop(tasker);
+}
+
+void PostAfterStopMultiWorker()
+{
+    Tasker<int, 4> tasker { [](int) { } };
+
+    PostAfterStop(tasker);
+}
+
+// A worker posting while every other worker is busy keeps the item on its own deque, which must fail all the same
+void PostFromWorkerAfterStop()
+{
+    std::atomic_size_t arrived { 0 };
+    std::atomic_int posted { -1 };
+    Tasker<int, 2> tasker { [&](int) {
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        const auto first = arrived.fetch_add(1) == 0;
+
+        // Both items usually run at once, one per worker, though a single worker may get them one after the other
+        while (arrived.load() < 2 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+
+        if (first) {
+            tasker.RequestStop();
+            posted = tasker.Post(2) ? 1 : 0;
+        }
+
+        while (posted.load() < 0)
+            std::this_thread::yield();
+    } };
+
+    CHECK(tasker.Post(1));
+    CHECK(tasker.Post(1));
+
+    tasker.Stop();
+
+    CHECK(posted.load() == 0);
+}
+
+void PostAfterAbort()
+{
+    Tasker<int, 0> tasker { [](int) { } };
+
+    tasker.Post(1);
+    tasker.Abort();
+
+    CHECK(!tasker.Post(1));
+    CHECK(tasker.WaitIdleFor(5s));
+}
+
+// The timer thread ends up blocked posting into the full queue, which Abort() has to unblock before joining it
+template <typename Tasker>
+void AbortWithTimerBlocked(Tasker& tasker)
+{
+    for (std::size_t n = 0; n < 64; ++n)
+        tasker.PostAfter(0ms, 1);
+
+    std::this_thread::sleep_for(50ms);
+
+    CHECK(tasker.Abort() <= 64);
+    CHECK(!tasker.Post(1));
+    CHECK(tasker.WaitIdleFor(5s));
+}
+
+void AbortWithTimerBlockedSingleWorker()
+{
+    Tasker<int, 1> tasker { [](int) { std::this_thread::sleep_for(5ms); }, { .bound = { 2, Overflow::Block } } };
+
+    AbortWithTimerBlocked(tasker);
+}
+
+void AbortWithTimerBlockedMultiWorker()
+{
+    Tasker<int, 2> tasker { [](int) { std::this_thread::sleep_for(5ms); }, { .bound = { 2, Overflow::Block } } };
+
+    AbortWithTimerBlocked(tasker);
+}
+
+} // namespace
+
+int main()
+{
+    // First, before any thread waiting in the cache is old enough to exit and throw the count off
+    ElasticGrowShrink();
+    WaitIdleAfterPost();
+    WaitIdleAfterPostSpsc();
+    WaitIdleAfterPostMultiWorker();
+    WaitIdleAfterPostTaskerBase();
+    WaitIdleAfterRejectedPosts();
+    WaitIdleAfterEvictions();
+    WaitIdleAfterClear();
+    WaitIdleAfterMoveAssign<1, ConcurrentQueue<int>>();
+    WaitIdleAfterMoveAssign<1, PriorityQueue<int, 2>>();
+    WaitIdleAfterMoveAssign<2, ConcurrentQueue<int>>();
+    PostPriority();
+    PostKeyedOrder();
+    PostAfterStopSingleWorker();
+    PostAfterStopMultiWorker();
+    PostFromWorkerAfterStop();
+    PostAfterAbort();
+    AbortWithTimerBlockedSingleWorker();
+    AbortWithTimerBlockedMultiWorker();
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "tasker.h"
+#include "timer_wheel.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = TimerWheel<std::uint64_t>::Clock;
+
+// One tick per nanosecond from a fixed origin, so that ticks and times are the same numbers
+const auto kOrigin = Clock::now();
+
+Clock::time_point At(std::uint64_t tick)
+{
+    return kOrigin + Clock::duration { static_cast<Clock::rep>(tick) };
+}
+
+// Items spread over every level and past the last one fire exactly at their tick, whatever cascades on the way
+void FiresAcrossLevels()
+{
+    TimerWheel<std::uint64_t> wheel { Clock::duration { 1 }, kOrigin };
+    std::mt19937_64 random { 42 };
+    std::map<std::uint64_t, std::size_t> due;
+
+    std::vector<std::uint64_t> ticks { 1, 255, 256, 257, 511, 65535, 65536, 65537, 1 << 24, (1 << 24) + 1,
+        (std::uint64_t { 1 } << 32) - 1, std::uint64_t { 1 } << 32, (std::uint64_t { 1 } << 32) + 3, std::uint64_t { 3 } << 33 };
+
+    for (std::size_t n = 0; n < 2000; ++n)
+        ticks.push_back(1 + ((random() % (std::uint64_t { 1 } << 34)) >> (random() % 30)));
+
+    for (const auto tick : ticks) {
+        wheel.Schedule(At(tick), {}, tick);
+        ++due[tick];
+    }
+
+    std::vector<std::uint64_t> fired;
+
+    for (const auto& [tick, count] : due) {
+        CHECK(wheel.Deadline() && *wheel.Deadline() <= At(tick));
+
+        wheel.Advance(At(tick - 1), std::back_inserter(fired));
+        CHECK(fired.empty());
+
+        wheel.Advance(At(tick), std::back_inserter(fired));
+        CHECK(fired.size() == count);
+        CHECK(std::all_of(fired.begin(), fired.end(), [tick](auto value) { return value == tick; }));
+
+        fired.clear();
+    }
+
+    CHECK(wheel.Empty());
+    CHECK(!wheel.Deadline());
+}
+
+// Cancelled items never fire, and a handle stops working once its item fired, even when the node is reused
+void CancelAndReuse()
+{
+    TimerWheel<std::uint64_t> wheel { Clock::duration { 1 }, kOrigin };
+    std::vector<std::uint64_t> fired;
+
+    const auto kept = wheel.Schedule(At(300), {}, 300);
+    const auto cancelled = wheel.Schedule(At(70000), {}, 70000);
+
+    CHECK(wheel.Cancel(cancelled));
+    CHECK(!wheel.Cancel(cancelled));
+    CHECK(wheel.Size() == 1);
+
+    wheel.Advance(At(100000), std::back_inserter(fired));
+    CHECK((fired == std::vector<std::uint64_t> { 300 }));
+    CHECK(!wheel.Cancel(kept));
+
+    const auto reused = wheel.Schedule(At(200000), {}, 200000);
+
+    CHECK(reused.index == kept.index || reused.index == cancelled.index);
+    CHECK(!wheel.Cancel(kept));
+    CHECK(!wheel.Cancel(cancelled));
+    CHECK(wheel.Cancel(reused));
+}
+
+// A periodic item fires once per period, even across a level boundary, until it's cancelled
+void Periodic()
+{
+    TimerWheel<std::uint64_t> wheel { Clock::duration { 1 }, kOrigin };
+    std::vector<std::uint64_t> fired;
+
+    const auto timer = wheel.Schedule(At(250), Clock::duration { 10 }, 1);
+
+    wheel.Advance(At(249), std::back_inserter(fired));
+    CHECK(fired.empty());
+
+    wheel.Advance(At(280), std::back_inserter(fired));
+    CHECK(fired.size() == 4);
+
+    CHECK(wheel.Cancel(timer));
+    wheel.Advance(At(1000), std::back_inserter(fired));
+    CHECK(fired.size() == 4);
+}
+
+// Delayed posts run no earlier than their delay, and a cancelled one not at all
+void PostAfter()
+{
+    std::atomic_int sum { 0 };
+    Tasker<int, 1> tasker { [&](int value) { sum += value; } };
+    const auto start = Clock::now();
+    std::atomic<Clock::time_point> ran {};
+    Tasker<int, 1> timed { [&](int) { ran = Clock::now(); } };
+
+    timed.PostAfter(30ms, 0);
+    tasker.PostAfter(10ms, 1);
+    CHECK(tasker.Cancel(tasker.PostAfter(20ms, 100)));
+
+    std::this_thread::sleep_for(60ms);
+
+    CHECK(tasker.WaitIdleFor(5s));
+    CHECK(timed.WaitIdleFor(5s));
+    CHECK(sum.load() == 1);
+    CHECK(ran.load() - start >= 30ms);
+}
+
+} // namespace
+
+int main()
+{
+    FiresAcrossLevels();
+    CancelAndReuse();
+    Periodic();
+    PostAfter();
+
+    return 0;
+}
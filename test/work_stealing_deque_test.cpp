@@ -0,0 +1,83 @@
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "work_stealing_deque.h"
+
+namespace {
+
+// The owner takes back the newest item, thieves the oldest one
+void OwnerLifoThiefFifo()
+{
+    WorkStealingDeque<int, 4> deque;
+
+    for (int n = 1; n <= 4; ++n)
+        CHECK(deque.TryEmplace(n));
+
+    CHECK(!deque.TryEmplace(5));
+    CHECK(deque.Size() == 4);
+    CHECK(deque.Steal() == 1);
+    CHECK(deque.Pop() == 4);
+    CHECK(deque.Pop() == 3);
+    CHECK(deque.Steal() == 2);
+    CHECK(!deque.Pop());
+    CHECK(!deque.Steal());
+    CHECK(deque.Empty());
+}
+
+// Thieves racing the owner, for the last item too, take every item exactly once between them
+void StealRaces()
+{
+    constexpr std::size_t kItems = 200000;
+    constexpr std::size_t kThieves = 3;
+
+    WorkStealingDeque<std::size_t, 64> deque;
+    std::vector<std::atomic_int> taken(kItems);
+    std::atomic_bool done { false };
+    std::vector<std::thread> thieves;
+
+    for (std::size_t n = 0; n < kThieves; ++n) {
+        thieves.emplace_back([&] {
+            while (!done.load()) {
+                if (auto value = deque.Steal())
+                    ++taken[*value];
+            }
+        });
+    }
+
+    for (std::size_t n = 0; n < kItems; ++n) {
+        // Full, a thief still moving an item out of the slot, or just every third push: the owner pops one itself
+        while (!deque.TryEmplace(n)) {
+            if (auto value = deque.Pop())
+                ++taken[*value];
+        }
+
+        if (n % 3 == 0) {
+            if (auto value = deque.Pop())
+                ++taken[*value];
+        }
+    }
+
+    while (auto value = deque.Pop())
+        ++taken[*value];
+
+    done = true;
+
+    for (auto& thief : thieves)
+        thief.join();
+
+    for (const auto& count : taken)
+        CHECK(count.load() == 1);
+}
+
+} // namespace
+
+int main()
+{
+    OwnerLifoThiefFifo();
+    StealRaces();
+
+    return 0;
+}